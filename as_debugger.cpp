@@ -5,11 +5,21 @@
 #include <array>
 #include <bitset>
 #include <charconv>
+#include <deque>
+#include <map>
 
 void asIDBVariable::Evaluate()
 {
     if (evaluated)
-        return;
+    {
+        // values are formatted again if the client asks for
+        // a different format, if their evaluator cares.
+        if (hex == dbg.cache->hex_values || !address.address || !address.typeId ||
+            !dbg.cache->GetEvaluator(address).UsesHex())
+            return;
+
+        evaluated = false;
+    }
     // getters don't evaluate and are
     // just placeholders, but they need
     // a ref ID.
@@ -20,11 +30,40 @@ void asIDBVariable::Evaluate()
     }
 
     auto var = ptr.lock();
+    hex = dbg.cache->hex_values;
     dbg.cache->GetEvaluator(var->address).Evaluate(var);
     evaluated = true;
+    HashValue();
 
     if (expandable)
         SetRefId();
+
+    dbg.cache->UpdateMemoryUsage(*this);
+}
+
+void asIDBVariable::HashValue()
+{
+    // primitives & enums are hashed from memory,
+    // so that the format they're shown in doesn't matter.
+    if (address.address && address.typeId && !(address.typeId & asTYPEID_MASK_OBJECT))
+    {
+        if (auto data = address.ResolveAs<const char>())
+        {
+            int size = dbg.cache->ctx->GetEngine()->GetSizeOfPrimitiveType(address.typeId);
+
+            if (size > 0)
+            {
+                valueHash = std::hash<std::string_view>()(std::string_view(data, size));
+                return;
+            }
+        }
+    }
+
+    // only the part of the value the client is shown is
+    // hashed, plus its length, so huge values stay cheap.
+    size_t hash = std::hash<std::string_view>()(value.substr(0, dbg.preview_length));
+    asIDBHashCombine(hash, value.size());
+    valueHash = hash;
 }
 
 void asIDBVariable::SetRefId()
@@ -32,19 +71,99 @@ void asIDBVariable::SetRefId()
     if (expandRefId.has_value())
         return;
 
+    // objects reachable from multiple paths (or from
+    // themselves) are only expanded once; the rest of
+    // the paths share the first variable's ref ID.
+    if ((address.typeId & asTYPEID_MASK_OBJECT) && !getter)
+    {
+        if (void *object = address.ResolveAs<void>())
+        {
+            asIDBObjectKey key { object, address.typeId & ~(asTYPEID_OBJHANDLE | asTYPEID_HANDLETOCONST) };
+            auto [it, inserted] = dbg.cache->objects.try_emplace(key, ptr);
+
+            if (!inserted)
+            {
+                auto canonical = it->second.lock();
+
+                if (canonical && canonical.get() != this && canonical->expandRefId)
+                {
+                    alias = canonical;
+                    expandRefId = canonical->expandRefId;
+                    SetValue(fmt::format("{} (see {})", value, canonical->GetPath()));
+                    return;
+                }
+
+                it->second = ptr;
+            }
+        }
+    }
+
     auto &refs = dbg.cache->variable_refs;
 
-    int64_t next_id = refs.size() + 1;
+    int64_t next_id = dbg.cache->next_ref_id++;
     expandRefId = next_id;
     refs.emplace(next_id, ptr);
 }
 
+std::string asIDBVariable::GetPath() const
+{
+    std::string path = identifier.Combine();
+
+    for (auto parent = owner.lock(); parent; parent = parent->owner.lock())
+    {
+        // getters have a child with the same name
+        // that holds the result.
+        if (parent->identifier.name.empty() || parent->getter)
+            continue;
+
+        if (path.empty() || path[0] == '[')
+            path = parent->identifier.Combine() + path;
+        else
+            path = fmt::format("{}.{}", parent->identifier.Combine(), path);
+    }
+
+    return path;
+}
+
+void asIDBVariable::SetValue(std::string_view str)
+{
+    auto &cache = *dbg.cache;
+    value = cache.strings.Store(str);
+    cache.value_bytes = cache.value_bytes - valueUsage + value.size();
+    valueUsage = value.size();
+}
+
+size_t asIDBVariable::CalculateMemoryUsage() const
+{
+    size_t usage = sizeof(*this) + identifier.name.capacity() + identifier.ns.capacity() +
+                   (namedProps.capacity() + indexedProps.capacity() + chunks.capacity()) * sizeof(Ptr) +
+                   propsByName.size() * (sizeof(NameMap::value_type) + sizeof(void *)) +
+                   indexedSlots.size() * (sizeof(std::pair<size_t, size_t>) + sizeof(void *));
+
+    // copies of objects that we're holding on to
+    if ((stackValue.typeId & asTYPEID_MASK_OBJECT) && !(stackValue.typeId & asTYPEID_OBJHANDLE) &&
+        !stackValue.borrowed && stackValue.type)
+        usage += stackValue.type->GetSize();
+
+    return usage;
+}
+
 void asIDBVariable::Expand()
 {
     Evaluate();
 
+    if (auto canonical = alias.lock())
+    {
+        canonical->Expand();
+        return;
+    }
+
     if (expanded)
+    {
+        if (lruEntry)
+            dbg.cache->TouchExpanded(ptr.lock());
         return;
+    }
     else if (!expandRefId)
         return;
 
@@ -52,30 +171,89 @@ void asIDBVariable::Expand()
 
     auto var = ptr.lock();
 
+    // virtual folders only pick up a range of their container.
+    if (chunkCount)
+    {
+        CreateChunks();
+        dbg.cache->UpdateMemoryUsage(*this);
+        return;
+    }
+
     if (!getter)
     {
         dbg.cache->GetEvaluator(var->address).Expand(var);
+        SortChildren();
+        dbg.cache->EvaluatePlainChildren(*this);
+
+        if (IsChunked())
+            CreateChunks();
+
+        dbg.cache->UpdateMemoryUsage(*this);
+        dbg.cache->TouchExpanded(var);
+        dbg.cache->EnforceMemoryBudget(*this);
         return;
     }
 
     // getters are a bit special; we have to fetch the variable
     // that our getter is linked to, & store the result in stack memory.
-    auto ctx = dbg.cache->ctx;
+    auto &cache = *dbg.cache;
+    void *object = this->owner.lock()->address.ResolveAs<void>();
+
+    var->ClearChildren();
+
+    // the same getter on the same object has already been
+    // run this break; share its result rather than running it again.
+    asIDBGetterKey key { object, getter };
+
+    if (auto it = cache.getter_results.find(key); it != cache.getter_results.end())
+    {
+        if (auto result = it->second.lock())
+        {
+            var->get_evaluated = var->CreateChildVariable(
+                var->identifier, { result->address.typeId, result->address.constant, nullptr }, result->typeName);
+
+            // the value is copied rather than pointed to, since
+            // the variable holding it may be evicted before we are.
+            if (result->stackValue.IsValid())
+            {
+                var->get_evaluated->stackValue = result->stackValue;
+                var->get_evaluated->address.address = var->get_evaluated->stackValue.GetPointer<void>(true);
+            }
+            else
+            {
+                var->get_evaluated->value = result->value;
+                var->get_evaluated->evaluated = true;
+            }
+
+            cache.TouchExpanded(var);
+            return;
+        }
+    }
+
+    // getters run on a context of their own, so that they
+    // still work if the one being debugged has thrown.
+    asIDBPooledContext ctx(dbg, cache.ctx->GetEngine());
 
     dbg.internal_execution = true;
-    ctx->PushState();
+    dbg.internal_deadline = std::chrono::steady_clock::now() + dbg.internal_budget;
 
     ctx->Prepare(getter);
-    ctx->SetObject(this->owner.lock()->address.ResolveAs<void>());
+    ctx->SetObject(object);
     ctx->Execute();
-        
-    var->namedProps.clear();
-    var->indexedProps.clear();
 
-    if (ctx->GetState() != asEXECUTION_FINISHED)
+    if (ctx->GetState() == asEXECUTION_SUSPENDED)
+    {
+        // a suspended nested state can't be popped
+        ctx->Abort();
+
+        var->get_evaluated = var->CreateChildVariable(var->identifier, {}, "");
+        var->get_evaluated->value = "(timed out)";
+        var->get_evaluated->evaluated = true;
+    }
+    else if (ctx->GetState() != asEXECUTION_FINISHED)
     {
         var->get_evaluated = var->CreateChildVariable(var->identifier, {}, "");
-        var->get_evaluated->value = fmt::format("Exception thrown ({})", ctx->GetExceptionString());
+        var->get_evaluated->SetValue(fmt::format("Exception thrown ({})", ctx->GetExceptionString()));
         var->get_evaluated->evaluated = true;
     }
     else
@@ -83,17 +261,23 @@ void asIDBVariable::Expand()
         asDWORD    returnFlags;
         int        typeId = getter->GetReturnTypeId(&returnFlags);
         asIDBValue returnValue(ctx->GetEngine(), ctx->GetAddressOfReturnValue(), typeId,
-                                (returnFlags & asTM_INOUTREF) != 0);
+                                (returnFlags & asTM_INOUTREF) != 0, true);
 
-        asIDBVariable::Ptr child =
+        var->get_evaluated =
             var->CreateChildVariable(var->identifier, { typeId, (returnFlags & asTM_CONST) != 0, nullptr },
-                                        dbg.cache->GetTypeNameFromType({ typeId, (asETypeModifiers) returnFlags }));
-        child->stackValue = std::move(returnValue);
-        child->address.address = child->stackValue.GetPointer<void>(true);
+                                        cache.GetTypeNameFromType({ typeId, (asETypeModifiers) returnFlags }));
+        var->get_evaluated->stackValue = std::move(returnValue);
+        var->get_evaluated->address.address = var->get_evaluated->stackValue.GetPointer<void>(true);
     }
 
-    ctx->PopState();
+    cache.getter_results.emplace(key, var->get_evaluated);
+
+    dbg.internal_deadline.reset();
     dbg.internal_execution = false;
+
+    cache.UpdateMemoryUsage(*var->get_evaluated);
+    cache.TouchExpanded(var);
+    cache.EnforceMemoryBudget(*this);
 }
 
 asIDBVariable::Ptr asIDBVariable::CreateChildVariable(asIDBVarName identifier, asIDBVarAddr address,
@@ -104,383 +288,1593 @@ asIDBVariable::Ptr asIDBVariable::CreateChildVariable(asIDBVarName identifier, a
     child->identifier = identifier;
     child->address = address;
     child->typeName = typeName;
+    dbg.cache->UpdateMemoryUsage(*child);
+    child->pathHash = pathHash;
+    asIDBHashCombine(child->pathHash, child->identifier.ns);
+    asIDBHashCombine(child->pathHash, child->identifier.name);
     if (identifier.name[0] == '[')
         indexedProps.push_back(child);
     else
-        namedProps.insert(child);
+        namedProps.push_back(child);
     return child;
 }
 
-asIDBScope::asIDBScope(asUINT offset, asIDBDebugger &dbg, asIScriptFunction *function) :
-    offset(offset),
-    parameters(dbg.cache->CreateVariable()),
-    locals(dbg.cache->CreateVariable()),
-    registers(dbg.cache->CreateVariable())
+void asIDBVariable::SortChildren()
 {
-    CalcLocals(dbg, function, parameters);
-    CalcLocals(dbg, function, locals);
-    CalcLocals(dbg, function, registers);
-}
-
-void asIDBScope::CalcLocals(asIDBDebugger &dbg, asIScriptFunction *function, asIDBVariable::Ptr &container)
-{
-    if (!function || offset == SCOPE_SYSTEM)
+    if (namedProps.size() < 2)
         return;
 
-    auto  &cache = *dbg.cache.get();
-    auto   ctx = cache.ctx;
-    asUINT numParams = function->GetParamCount();
-    asUINT numLocals = ctx->GetVarCount(offset);
-
-    asUINT start = 0, end = 0;
+    // build the keys once up front, rather than
+    // re-walking the names for every comparison.
+    std::vector<std::pair<std::string, Ptr>> keyed;
+    keyed.reserve(namedProps.size());
 
-    if (container == parameters)
-        end = numParams;
-    else
+    for (auto &prop : namedProps)
     {
-        start = numParams;
-        end = numLocals;
+        std::string key;
+        asIDBNatIKeyAppend(key, prop->identifier.ns);
+        key.push_back('\0');
+        asIDBNatIKeyAppend(key, prop->identifier.name);
+        // names that only differ by case are kept apart,
+        // so that duplicates end up next to each other.
+        key.push_back('\0');
+        key.append(prop->identifier.ns);
+        key.push_back('\0');
+        key.append(prop->identifier.name);
+        keyed.emplace_back(std::move(key), std::move(prop));
     }
 
-    if (container == locals)
+    std::stable_sort(keyed.begin(), keyed.end(), [](const auto &a, const auto &b) { return a.first < b.first; });
+
+    for (size_t i = 0; i < keyed.size(); i++)
+        namedProps[i] = std::move(keyed[i].second);
+
+    // siblings with the same name (shadowed locals, etc) are
+    // told apart by their order, so they don't share a hash.
+    for (size_t i = 1, ordinal = 0; i < namedProps.size(); i++)
     {
-        if (auto thisPtr = ctx->GetThisPointer(offset))
-        {
-            int thisTypeId = ctx->GetThisTypeId(offset);
+        auto &child = *namedProps[i];
+        ordinal = keyed[i].first == keyed[i - 1].first ? ordinal + 1 : 0;
 
-            asIDBTypeId typeKey { thisTypeId, asTM_NONE };
+        if (!ordinal)
+            continue;
 
-            const std::string_view viewType = cache.GetTypeNameFromType(typeKey);
+        child.pathHash = pathHash;
+        asIDBHashCombine(child.pathHash, child.identifier.ns);
+        asIDBHashCombine(child.pathHash, child.identifier.name);
+        asIDBHashCombine(child.pathHash, ordinal);
+    }
+}
 
-            asIDBVarAddr idKey { thisTypeId, false, thisPtr };
+asIDBVariable::Ptr asIDBVariable::FindChild(std::string_view name)
+{
+    if (propsByNameSource != namedProps.size() + indexedProps.size())
+    {
+        propsByName.clear();
 
-            asIDBVariable::Ptr var = container->CreateChildVariable("this", idKey, viewType);
+        for (auto &prop : namedProps)
+            propsByName.emplace(prop->identifier.Combine(), prop);
+        for (auto &prop : indexedProps)
+            propsByName.emplace(prop->identifier.name, prop);
 
-            this_ptr = var;
-        }
+        propsByNameSource = namedProps.size() + indexedProps.size();
     }
 
-    for (asUINT n = start; n < end; n++)
+    if (auto it = propsByName.find(std::string(name)); it != propsByName.end())
+        return it->second;
+
+    for (auto &chunk : chunks)
+        if (chunk->identifier.name == name)
+            return chunk;
+
+    // windowed elements might not have been created yet
+    if (indexedCount && name.size() > 2 && name.front() == '[' && name.back() == ']')
     {
-        const char      *name;
-        int              typeId;
-        asETypeModifiers modifiers;
-        int              stackOffset;
-        ctx->GetVar(n, offset, &name, &typeId, &modifiers, 0, &stackOffset);
+        size_t index;
+        auto   result = std::from_chars(name.data() + 1, name.data() + name.size() - 1, index);
 
-        bool isTemporary = (container != parameters) && (!name || !*name);
+        if (result.ec == std::errc() && result.ptr == name.data() + name.size() - 1)
+            return GetIndexed(index);
+    }
 
-        if (!ctx->IsVarInScope(n, offset))
-            continue;
-        else if (isTemporary != (container == registers))
-            continue;
+    return nullptr;
+}
 
-        void *ptr = ctx->GetAddressOfVar(n, offset);
+void asIDBVariable::ClearChildren()
+{
+    propsByName.clear();
+    propsByNameSource = 0;
+    namedProps.clear();
+    indexedProps.clear();
+    indexedSlots.clear();
+    chunks.clear();
+}
 
-        asIDBTypeId typeKey { typeId, modifiers };
+bool asIDBVariable::IsChunked() const
+{
+    return (chunkCount ? chunkCount : GetIndexedCount()) > dbg.chunk_size;
+}
 
-        std::string localName = (name && *name) ? fmt::format("{} (&{})", name, n) : fmt::format("&{}", n);
+void asIDBVariable::CreateChunks()
+{
+    auto   container = chunkCount ? owner.lock() : ptr.lock();
+    size_t start = chunkStart, count = chunkCount ? chunkCount : GetIndexedCount();
+    size_t size = std::max(dbg.chunk_size, (size_t) 2);
 
-        const std::string_view viewType = cache.GetTypeNameFromType(typeKey);
+    if (!container)
+        return;
 
-        asIDBVarAddr idKey { typeId, (modifiers & asTM_CONST) != 0, ptr };
+    if (count <= size)
+    {
+        // containers that are small enough just
+        // show their elements directly.
+        if (!chunkCount)
+            return;
 
-        asIDBVariable::Ptr var = container->CreateChildVariable(std::move(localName), idKey, viewType);
+        container->ExpandWindow(start, count);
 
-        local_by_index.emplace(n, var);
+        for (size_t i = start; i < start + count; i++)
+            if (auto element = container->GetIndexed(i))
+                indexedProps.push_back(element);
+
+        return;
     }
 
-    container->evaluated = container->expanded = true;
+    // every folder on this level covers the smallest power
+    // of the chunk size that keeps the level within it.
+    size_t span = size;
 
-    if (!container->namedProps.empty() ||
-        !container->indexedProps.empty())
-        container->SetRefId();
+    while ((count + span - 1) / span > size)
+        span *= size;
+
+    for (size_t s = start, end = start + count; s < end; s += span)
+    {
+        size_t n = std::min(span, end - s);
+
+        auto folder = dbg.cache->CreateVariable();
+        folder->owner = container;
+        folder->identifier = fmt::format("[{}..{}]", s, s + n - 1);
+        folder->chunkStart = s;
+        folder->chunkCount = n;
+        folder->pathHash = pathHash;
+        asIDBHashCombine(folder->pathHash, folder->identifier.name);
+        folder->SetValue(fmt::format("{} elements", n));
+        folder->evaluated = folder->expandable = true;
+        folder->SetRefId();
+        dbg.cache->UpdateMemoryUsage(*folder);
+        chunks.push_back(folder);
+    }
 }
 
-/*virtual*/ void asIDBCache::Refresh()
+asIDBVariable::Ptr asIDBVariable::CreateIndexedChild(size_t index, asIDBVarAddr address, std::string_view typeName)
 {
+    auto child = CreateChildVariable(fmt::format("[{}]", index), address, typeName);
+
+    if (indexedCount)
+        indexedSlots.emplace(index, indexedProps.size() - 1);
+
+    return child;
 }
 
-/*virtual*/ const std::string_view asIDBCache::GetTypeNameFromType(asIDBTypeId id)
+void asIDBVariable::ExpandWindow(size_t start, size_t count)
 {
-    if (auto f = type_names.find(id); f != type_names.end())
-        return f->second.c_str();
-
-    auto        type = ctx->GetEngine()->GetTypeInfoById(id.typeId);
-    const char *rawName = "???";
+    Expand();
 
-    if (!type)
-    {
-        // a primitive
-        switch (id.typeId & asTYPEID_MASK_SEQNBR)
-        {
-        case asTYPEID_BOOL:   rawName = "bool"; break;
-        case asTYPEID_INT8:   rawName = "int8"; break;
-        case asTYPEID_INT16:  rawName = "int16"; break;
-        case asTYPEID_INT32:  rawName = "int32"; break;
-        case asTYPEID_INT64:  rawName = "int64"; break;
-        case asTYPEID_UINT8:  rawName = "uint8"; break;
-        case asTYPEID_UINT16: rawName = "uint16"; break;
-        case asTYPEID_UINT32: rawName = "uint32"; break;
-        case asTYPEID_UINT64: rawName = "uint64"; break;
-        case asTYPEID_FLOAT:  rawName = "float"; break;
-        case asTYPEID_DOUBLE: rawName = "double"; break;
-        default:              rawName = "???"; break;
-        }
-    }
-    else
+    if (auto canonical = alias.lock())
     {
-        rawName = type->GetName();
+        canonical->ExpandWindow(start, count);
+        return;
     }
 
-    std::string name = fmt::format("{}{}{}{}", (id.modifiers & asTM_CONST) ? "const " : "", rawName,
-                                   (id.typeId & (asTYPEID_HANDLETOCONST | asTYPEID_OBJHANDLE)) ? "@" : "",
-                                   ((id.modifiers & asTM_INOUTREF) == asTM_INOUTREF) ? "&"
-                                   : ((id.modifiers & asTM_INOUTREF) == asTM_INREF)  ? "&in"
-                                   : ((id.modifiers & asTM_INOUTREF) == asTM_OUTREF) ? "&out"
-                                                                                     : "");
+    if (!indexedCount || start >= indexedCount.value())
+        return;
 
-    return type_names.emplace(id, std::move(name)).first->second;
+    count = std::min(count, indexedCount.value() - start);
+
+    dbg.cache->GetEvaluator(address).ExpandWindow(ptr.lock(), start, count);
+    dbg.cache->EvaluatePlainChildren(*this);
+    dbg.cache->UpdateMemoryUsage(*this);
+    dbg.cache->EnforceMemoryBudget(*this);
 }
 
-void *asIDBCache::ResolvePropertyAddress(const asIDBVarAddr &id, int propertyIndex, int offset, int compositeOffset,
-                                         bool isCompositeIndirect)
+asIDBVariable::Ptr asIDBVariable::GetIndexed(size_t index)
 {
-    if (id.typeId & asTYPEID_SCRIPTOBJECT)
+    if (auto canonical = alias.lock())
+        return canonical->GetIndexed(index);
+
+    if (!indexedCount)
+        return index < indexedProps.size() ? indexedProps[index] : nullptr;
+
+    auto it = indexedSlots.find(index);
+
+    if (it == indexedSlots.end())
     {
-        asIScriptObject *obj = id.ResolveAs<asIScriptObject>();
-        return obj->GetAddressOfProperty(propertyIndex);
+        ExpandWindow(index, 1);
+        it = indexedSlots.find(index);
+
+        if (it == indexedSlots.end())
+            return nullptr;
     }
 
-    // indirect changes our ptr to
-    // *(object + compositeOffset) + offset
-    if (isCompositeIndirect)
-    {
-        void *propAddr = *reinterpret_cast<uint8_t **>(id.ResolveAs<uint8_t>() + compositeOffset);
+    return indexedProps[it->second];
+}
 
-        // if we're null, leave it alone, otherwise point to
-        // where we really need to be pointing
-        if (propAddr)
-            propAddr = reinterpret_cast<uint8_t *>(propAddr) + offset;
+void asIDBScope::Materialize(asIDBDebugger &dbg)
+{
+    if (materialized)
+        return;
 
-        return propAddr;
+    materialized = true;
+
+    auto &cache = *dbg.cache.get();
+    parameters = cache.CreateVariable();
+    locals = cache.CreateVariable();
+    registers = cache.CreateVariable();
+
+    // frames are identified by their function & their
+    // depth from the bottom of the stack, which stays the
+    // same while stepping inside of them.
+    size_t frameHash = std::hash<asIScriptFunction *>()(function);
+    asIDBHashCombine(frameHash, cache.ctx->GetCallstackSize() - offset);
+    hash = frameHash;
+
+    for (auto &container : { parameters, locals, registers })
+    {
+        container->pathHash = frameHash;
+        asIDBHashCombine(frameHash, 0);
     }
 
-    return id.ResolveAs<uint8_t>() + offset + compositeOffset;
+    CalcLocals(dbg);
+
+    for (auto &container : { parameters, locals, registers })
+    {
+        container->SortChildren();
+        container->evaluated = container->expanded = true;
+
+        if (!container->namedProps.empty() ||
+            !container->indexedProps.empty())
+            container->SetRefId();
+    }
 }
 
-/*virtual*/ asIDBExpected<asIDBVariable::WeakPtr> asIDBCache::ResolveExpression(std::string_view   expr,
-                                                                                std::optional<int> stack_index)
+void asIDBScope::CalcLocals(asIDBDebugger &dbg)
 {
-    // just in case your IDE sends `@ent` or `&ent` for a hover
-    if (!expr.empty() && (expr[0] == '@' || (expr.size() >= 2 && expr[0] == '&' && !isdigit(expr[1]))))
-        expr.remove_prefix(1);
+    if (!function || offset == SCOPE_SYSTEM)
+        return;
 
-    if (expr.empty())
-        return asIDBExpected("empty string");
+    auto  &cache = *dbg.cache.get();
+    auto   ctx = cache.ctx;
+    asUINT numParams = function->GetParamCount();
+    asUINT numLocals = ctx->GetVarCount(offset);
 
-    CacheCallstack();
+    if (auto thisPtr = ctx->GetThisPointer(offset))
+    {
+        int thisTypeId = ctx->GetThisTypeId(offset);
 
-    // isolate the variable name first
-    size_t           variable_end = expr.find_first_of(".[", 0);
-    std::string_view variable_name = expr.substr(0, variable_end);
+        asIDBTypeId typeKey { thisTypeId, asTM_NONE };
 
-    if (variable_name.empty())
-        return asIDBExpected("bad expression");
+        const std::string_view viewType = cache.GetTypeNameFromType(typeKey);
 
-    asIDBExpected<asIDBVariable::WeakPtr> variable;
-    asIDBCallStackEntry                  *stack = nullptr;
+        asIDBVarAddr idKey { thisTypeId, false, thisPtr };
 
-    if (stack_index.has_value())
-        stack = &call_stack[stack_index.value()];
+        asIDBVariable::Ptr var = locals->CreateChildVariable("this", idKey, viewType);
 
-    // if it starts with a & it has to be a local variable index
-    if (stack && variable_name[0] == '&')
+        this_ptr = var;
+    }
+
+    // parameters come first, then locals & temporaries
+    for (asUINT n = 0; n < numLocals; n++)
     {
-        uint32_t offset;
-        auto result = std::from_chars(&variable_name.front(), &variable_name.front() + variable_name.size(), offset);
+        if (!ctx->IsVarInScope(n, offset))
+            continue;
 
-        if (result.ec != std::errc())
-            return asIDBExpected("invalid numerical offset");
+        const char      *name;
+        int              typeId;
+        asETypeModifiers modifiers;
+        int              stackOffset;
+        ctx->GetVar(n, offset, &name, &typeId, &modifiers, 0, &stackOffset);
 
-        // check bounds
-        int m = ctx->GetVarCount(stack_index.value());
+        bool isParameter = n < numParams;
+        bool isTemporary = !isParameter && (!name || !*name);
+
+        asIDBVariable::Ptr &container = isParameter ? parameters : isTemporary ? registers : locals;
+
+        void *ptr = ctx->GetAddressOfVar(n, offset);
+
+        asIDBTypeId typeKey { typeId, modifiers };
+
+        std::string localName = (name && *name) ? fmt::format("{} (&{})", name, n) : fmt::format("&{}", n);
+
+        const std::string_view viewType = cache.GetTypeNameFromType(typeKey);
+
+        asIDBVarAddr idKey { typeId, (modifiers & asTM_CONST) != 0, ptr };
+
+        asIDBVariable::Ptr var = container->CreateChildVariable(std::move(localName), idKey, viewType);
+
+        local_by_index.emplace(n, var);
+
+        // later variables are in deeper scopes
+        if (!isTemporary)
+            local_by_name.insert_or_assign(name, var);
+    }
+}
+
+/*virtual*/ asIDBVariable::Ptr asIDBCache::FindVariable(int64_t ref)
+{
+    if (auto it = variable_refs.find(ref); it != variable_refs.end())
+        if (auto var = it->second.lock())
+            return var;
+
+    auto evicted = evicted_refs.find(ref);
+
+    if (evicted == evicted_refs.end())
+        return nullptr;
+
+    // expanding may evict other refs, so
+    // this can't be kept in the map.
+    EvictedRef entry = std::move(evicted->second);
+    evicted_refs.erase(evicted);
+
+    auto var = entry.root.lock();
+
+    for (auto &step : entry.path)
+    {
+        if (!var)
+            break;
+
+        var->Expand();
+
+        if (auto canonical = var->alias.lock())
+            var = canonical;
+
+        if (step.index == std::string::npos)
+            var = var->FindChild(step.name.Combine());
+        else if (step.index < var->namedProps.size() && var->namedProps[step.index]->identifier.name == step.name.name &&
+                 var->namedProps[step.index]->identifier.ns == step.name.ns)
+            var = var->namedProps[step.index];
+        else
+            var = nullptr;
+    }
+
+    // something else is there now
+    if (!var || var->pathHash != entry.pathHash)
+        return nullptr;
+
+    // keep handing out the same ID for it, since the client
+    // still has the old one. It's set before evaluating so that
+    // no new ID (or alias) is made; if the variable was given a
+    // new ID already, both refer to it.
+    if (!var->expandRefId)
+        var->expandRefId = ref;
+
+    var->Evaluate();
+    variable_refs.insert_or_assign(ref, var);
+    return var;
+}
+
+void asIDBCache::UpdateMemoryUsage(asIDBVariable &var)
+{
+    size_t usage = var.CalculateMemoryUsage();
+    memory_used = memory_used - var.memoryUsage + usage;
+    var.memoryUsage = usage;
+
+    value_bytes = value_bytes - var.valueUsage + var.value.size();
+    var.valueUsage = var.value.size();
+}
+
+void asIDBCache::TouchExpanded(const asIDBVariable::Ptr &var)
+{
+    if (var->lruEntry)
+        expanded_lru.splice(expanded_lru.end(), expanded_lru, var->lruEntry.value());
+    else
+        var->lruEntry = expanded_lru.insert(expanded_lru.end(), var);
+}
+
+/*virtual*/ void asIDBCache::EvaluatePlainChildren(asIDBVariable &var)
+{
+    // primitives carry an evaluator, plain objects a
+    // layout; both are only filled in past the threshold.
+    struct Pending
+    {
+        asIDBVariable            *var;
+        const asIDBTypeEvaluator *evaluator;
+        const PlainLayout        *layout;
+    };
+
+    std::vector<Pending> pending;
+    size_t               nodes = 0;
+
+    // count first, so small expansions don't pay for
+    // resolving evaluators they won't use here.
+    for (auto *children : { &var.namedProps, &var.indexedProps })
+        for (auto &child : *children)
+        {
+            if (child->evaluated || child->getter || !child->address.address)
+                continue;
+            else if (!(child->address.typeId & asTYPEID_MASK_OBJECT))
+            {
+                pending.push_back({ child.get(), nullptr, nullptr });
+                nodes++;
+            }
+            else if (child->address.ResolveAs<void>())
+            {
+                auto layout = GetPlainLayout(child->address.typeId);
+
+                if (!layout || layout->nodes > dbg.parallel_subtree_limit)
+                    continue;
+
+                pending.push_back({ child.get(), nullptr, layout });
+                nodes += layout->nodes;
+            }
+        }
+
+    if (nodes < dbg.parallel_threshold)
+        return;
+
+    // evaluators are looked up here, since the lookup
+    // caches into the registry.
+    for (auto &p : pending)
+        if (!p.layout)
+            p.evaluator = &GetEvaluator(p.var->address);
+
+    // each chunk formats into a buffer of its own, and
+    // records every node of its subtrees in pre-order
+    // along with the end of its text; ~0 means the node
+    // has to go through Evaluate instead.
+    struct Record
+    {
+        void  *address;
+        size_t end;
+    };
+
+    struct Chunk
+    {
+        size_t              first, last;
+        std::string         buffer;
+        std::vector<Record> records;
+    };
+
+    constexpr size_t   chunk_nodes = 256, skip = ~size_t(0);
+    std::vector<Chunk> chunks;
+    const bool         hex = hex_values;
+
+    for (size_t i = 0, n = 0; i < pending.size(); i++)
+    {
+        if (chunks.empty() || n >= chunk_nodes)
+        {
+            chunks.push_back({ i, i });
+            n = 0;
+        }
+
+        chunks.back().last = i + 1;
+        n += pending[i].layout ? pending[i].layout->nodes : 1;
+    }
+
+    // only reads memory; offsets were all
+    // resolved on this thread beforehand.
+    auto read = [this, hex](auto &self, const PlainLayout &layout, const asIDBVarAddr &id, Chunk &chunk) -> void {
+        const bool valid = id.address && id.ResolveAs<void>();
+        chunk.records.push_back({ id.address, skip });
+
+        for (auto &field : layout.fields)
+        {
+            asIDBVarAddr address { field.typeId, field.isReadOnly,
+                valid ? ResolvePropertyAddress(id, field.index, field.offset, field.compositeOffset, field.isCompositeIndirect) : nullptr };
+
+            if (field.layout)
+                self(self, *field.layout, address, chunk);
+            else if (field.evaluator && address.address && field.evaluator->FormatRaw(address, hex, chunk.buffer))
+                chunk.records.push_back({ address.address, chunk.buffer.size() });
+            else
+                chunk.records.push_back({ address.address, skip });
+        }
+    };
+
+    dbg.workers.Run(chunks.size(), [&](size_t c) {
+        Chunk &chunk = chunks[c];
+
+        for (size_t i = chunk.first; i < chunk.last; i++)
+        {
+            const Pending &p = pending[i];
+
+            if (p.layout)
+                read(read, *p.layout, p.var->address, chunk);
+            else if (p.evaluator->FormatRaw(p.var->address, hex, chunk.buffer))
+                chunk.records.push_back({ p.var->address.address, chunk.buffer.size() });
+            else
+                chunk.records.push_back({ p.var->address.address, skip });
+        }
+    });
+
+    auto commit = [this, hex](asIDBVariable &child, const Chunk &chunk, const Record &record, size_t &offset) {
+        if (record.end == skip)
+            return;
+
+        child.SetValue(std::string_view(chunk.buffer).substr(offset, record.end - offset));
+        child.hex = hex;
+        child.evaluated = true;
+        child.HashValue();
+        UpdateMemoryUsage(child);
+        offset = record.end;
+    };
+
+    // objects are shown the way the object evaluator
+    // would, and expanded unless another path got there
+    // first; a null var only skips over its records.
+    auto attach = [this, hex, &commit](auto &self, asIDBVariable *object, const PlainLayout &layout, const Chunk &chunk,
+                                       size_t &record, size_t &offset) -> void {
+        record++;
+
+        if (object)
+        {
+            object->expandable = !layout.fields.empty();
+            object->SetValue(fmt::format("{{{}}}", object->typeName));
+            object->hex = hex;
+            object->evaluated = true;
+            object->HashValue();
+
+            if (object->expandable)
+                object->SetRefId();
+
+            if (!object->expandable || !object->alias.expired())
+            {
+                UpdateMemoryUsage(*object);
+                object = nullptr;
+            }
+        }
+
+        for (auto &field : layout.fields)
+        {
+            const Record      &r = chunk.records[record];
+            asIDBVariable::Ptr child;
+
+            if (object)
+                child = object->CreateChildVariable(field.name, { field.typeId, field.isReadOnly, r.address }, field.typeName);
+
+            if (field.layout)
+                self(self, r.address ? child.get() : nullptr, *field.layout, chunk, record, offset);
+            else
+            {
+                record++;
+
+                if (child)
+                    commit(*child, chunk, r, offset);
+                else if (r.end != skip)
+                    offset = r.end;
+            }
+        }
+
+        if (object)
+        {
+            object->SortChildren();
+            object->expanded = true;
+            UpdateMemoryUsage(*object);
+            TouchExpanded(object->ptr.lock());
+        }
+    };
+
+    for (const Chunk &chunk : chunks)
+    {
+        size_t record = 0, offset = 0;
+
+        for (size_t i = chunk.first; i < chunk.last; i++)
+        {
+            if (pending[i].layout)
+                attach(attach, pending[i].var, *pending[i].layout, chunk, record, offset);
+            else
+                commit(*pending[i].var, chunk, chunk.records[record++], offset);
+        }
+    }
+}
+
+/*virtual*/ void asIDBCache::EnforceMemoryBudget(const asIDBVariable &keep)
+{
+    if (memory_used + strings.GetMemoryUsage() <= dbg.cache_memory_budget)
+        return;
+
+    std::vector<const asIDBVariable *> keep_chain;
+
+    for (auto var = keep.ptr.lock(); var; var = var->owner.lock())
+        keep_chain.push_back(var.get());
+
+    // evicting doesn't shrink the string arena by itself, so
+    // variables are evicted until they'd fit along with just
+    // their own values; the arena is compacted after.
+    for (auto it = expanded_lru.begin();
+         it != expanded_lru.end() && memory_used + value_bytes > dbg.cache_memory_budget;)
+    {
+        auto var = it->lock();
+
+        // entries of evicted children are
+        // cleaned up as we come across them.
+        if (!var)
+        {
+            it = expanded_lru.erase(it);
+            continue;
+        }
+
+        ++it;
+
+        // roots (scopes, globals, etc) are never evicted.
+        if (var->owner.expired() || std::find(keep_chain.begin(), keep_chain.end(), var.get()) != keep_chain.end())
+            continue;
+
+        EvictChildren(*var);
+    }
+
+    // only worth it once most of the arena is dead values
+    if (value_bytes < strings.GetMemoryUsage() / 2)
+        CompactStrings();
+}
+
+void asIDBCache::CompactStrings()
+{
+    asIDBStringArena compacted;
+
+    // every value is moved, even ones that weren't in
+    // the arena before; it's simpler than telling them apart.
+    for (auto &var : variables)
+        var->value = compacted.Store(var->value);
+
+    strings = std::move(compacted);
+}
+
+/*virtual*/ void asIDBCache::EvictChildren(asIDBVariable &var)
+{
+    // the path to each child is remembered from the
+    // root, since that will never be evicted.
+    using Step = EvictedRef::Step;
+
+    asIDBVariable::Ptr root = var.ptr.lock();
+    std::vector<Step>  path;
+
+    auto namedIndex = [](const asIDBVariable &owner, const asIDBVariable *child) {
+        auto it = std::find_if(owner.namedProps.begin(), owner.namedProps.end(),
+                               [child](const asIDBVariable::Ptr &prop) { return prop.get() == child; });
+        return it == owner.namedProps.end() ? std::string::npos : (size_t) (it - owner.namedProps.begin());
+    };
+
+    for (auto owner = root->owner.lock(); owner; owner = owner->owner.lock())
+    {
+        path.push_back({ root->identifier, namedIndex(*owner, root.get()) });
+        root = owner;
+    }
+
+    std::reverse(path.begin(), path.end());
+
+    auto evict = [&](auto &self, asIDBVariable &parent) -> void {
+        for (auto &children : { &parent.namedProps, &parent.indexedProps, &parent.chunks })
+        {
+            // the elements in a folder belong to its container,
+            // which handles them itself.
+            if (parent.chunkCount && children != &parent.chunks)
+                continue;
+
+            for (size_t i = 0; i < children->size(); i++)
+            {
+                auto &child = (*children)[i];
+                path.push_back({ child->identifier, children == &parent.namedProps ? i : std::string::npos });
+
+                // aliases share the ref ID of another variable,
+                // so only the variable that owns it is remembered.
+                if (child->expandRefId)
+                {
+                    int64_t ref = child->expandRefId.value();
+
+                    if (auto it = variable_refs.find(ref); it != variable_refs.end() && it->second.lock() == child)
+                    {
+                        evicted_refs.insert_or_assign(ref, EvictedRef { root, path, child->pathHash });
+                        variable_refs.erase(it);
+                    }
+                }
+
+                self(self, *child);
+
+                memory_used -= child->memoryUsage;
+                value_bytes -= child->valueUsage;
+                child->memoryUsage = child->valueUsage = 0;
+                variables.erase(child);
+
+                path.pop_back();
+            }
+        }
+    };
+
+    evict(evict, var);
+
+    var.ClearChildren();
+    var.get_evaluated.reset();
+    var.expanded = false;
+
+    if (var.lruEntry)
+    {
+        expanded_lru.erase(var.lruEntry.value());
+        var.lruEntry.reset();
+    }
+
+    UpdateMemoryUsage(var);
+}
+
+/*virtual*/ bool asIDBCache::TrackValue(const asIDBVariable &var)
+{
+    // variables that were filled in by hand (placeholders,
+    // folders) are hashed by the text they show.
+    size_t hash;
+
+    if (var.valueHash)
+        hash = var.valueHash.value();
+    else
+    {
+        hash = std::hash<std::string_view>()(var.value.substr(0, dbg.preview_length));
+        asIDBHashCombine(hash, var.value.size());
+    }
+
+    asIDBHashCombine(hash, var.typeName);
+
+    value_hashes.insert_or_assign(var.pathHash, hash);
+
+    auto it = previous_value_hashes.find(var.pathHash);
+    return it != previous_value_hashes.end() && it->second != hash;
+}
+
+/*virtual*/ void asIDBCache::Refresh()
+{
+}
+
+/*virtual*/ const std::string_view asIDBCache::GetTypeNameFromType(asIDBTypeId id)
+{
+    if (auto f = type_names.find(id); f != type_names.end())
+        return f->second.c_str();
+
+    auto        type = ctx->GetEngine()->GetTypeInfoById(id.typeId);
+    const char *rawName = "???";
+
+    if (!type)
+    {
+        // a primitive
+        switch (id.typeId & asTYPEID_MASK_SEQNBR)
+        {
+        case asTYPEID_BOOL:   rawName = "bool"; break;
+        case asTYPEID_INT8:   rawName = "int8"; break;
+        case asTYPEID_INT16:  rawName = "int16"; break;
+        case asTYPEID_INT32:  rawName = "int32"; break;
+        case asTYPEID_INT64:  rawName = "int64"; break;
+        case asTYPEID_UINT8:  rawName = "uint8"; break;
+        case asTYPEID_UINT16: rawName = "uint16"; break;
+        case asTYPEID_UINT32: rawName = "uint32"; break;
+        case asTYPEID_UINT64: rawName = "uint64"; break;
+        case asTYPEID_FLOAT:  rawName = "float"; break;
+        case asTYPEID_DOUBLE: rawName = "double"; break;
+        default:              rawName = "???"; break;
+        }
+    }
+    else
+    {
+        rawName = type->GetName();
+    }
+
+    std::string name = fmt::format("{}{}{}{}", (id.modifiers & asTM_CONST) ? "const " : "", rawName,
+                                   (id.typeId & (asTYPEID_HANDLETOCONST | asTYPEID_OBJHANDLE)) ? "@" : "",
+                                   ((id.modifiers & asTM_INOUTREF) == asTM_INOUTREF) ? "&"
+                                   : ((id.modifiers & asTM_INOUTREF) == asTM_INREF)  ? "&in"
+                                   : ((id.modifiers & asTM_INOUTREF) == asTM_OUTREF) ? "&out"
+                                                                                     : "");
+
+    return type_names.emplace(id, std::move(name)).first->second;
+}
+
+void *asIDBCache::ResolvePropertyAddress(const asIDBVarAddr &id, int propertyIndex, int offset, int compositeOffset,
+                                         bool isCompositeIndirect)
+{
+    if (id.typeId & asTYPEID_SCRIPTOBJECT)
+    {
+        asIScriptObject *obj = id.ResolveAs<asIScriptObject>();
+        return obj->GetAddressOfProperty(propertyIndex);
+    }
+
+    // indirect changes our ptr to
+    // *(object + compositeOffset) + offset
+    if (isCompositeIndirect)
+    {
+        void *propAddr = *reinterpret_cast<uint8_t **>(id.ResolveAs<uint8_t>() + compositeOffset);
+
+        // if we're null, leave it alone, otherwise point to
+        // where we really need to be pointing
+        if (propAddr)
+            propAddr = reinterpret_cast<uint8_t *>(propAddr) + offset;
+
+        return propAddr;
+    }
+
+    return id.ResolveAs<uint8_t>() + offset + compositeOffset;
+}
+
+/*virtual*/ asIDBExpected<asIDBVariable::WeakPtr> asIDBCache::ResolveExpression(std::string_view   expr,
+                                                                                std::optional<int> stack_index)
+{
+    // just in case your IDE sends `@ent` or `&ent` for a hover
+    if (!expr.empty() && (expr[0] == '@' || (expr.size() >= 2 && expr[0] == '&' && !isdigit(expr[1]))))
+        expr.remove_prefix(1);
+
+    if (expr.empty())
+        return asIDBExpected("empty string");
+
+    // isolate the variable name first
+    size_t           variable_end = expr.find_first_of(".[", 0);
+    std::string_view variable_name = expr.substr(0, variable_end);
+
+    if (variable_name.empty())
+        return asIDBExpected("bad expression");
+
+    asIDBExpected<asIDBVariable::WeakPtr> variable;
+    asIDBCallStackEntry                  *stack = nullptr;
+
+    if (stack_index.has_value())
+    {
+        CacheCallstack(stack_index.value() + 1);
+
+        if ((size_t) stack_index.value() >= call_stack.size())
+            return asIDBExpected("bad stack index");
+
+        stack = &call_stack[stack_index.value()];
+
+        // system functions have no variables
+        if (stack->scope.offset == SCOPE_SYSTEM)
+            stack = nullptr;
+        else
+            stack->scope.Materialize(dbg);
+    }
+
+    // if it starts with a & it has to be a local variable index
+    if (stack && variable_name[0] == '&')
+    {
+        uint32_t offset;
+        auto result = std::from_chars(&variable_name.front(), &variable_name.front() + variable_name.size(), offset);
+
+        if (result.ec != std::errc())
+            return asIDBExpected("invalid numerical offset");
+
+        // check bounds
+        int m = ctx->GetVarCount(stack->scope.offset);
+
+        if (m < 0)
+            return asIDBExpected("bad stack index");
+
+        if (offset >= (asUINT) m)
+            return asIDBExpected("stack offset out of bounds");
+
+        if (!ctx->IsVarInScope(offset, stack->scope.offset))
+            return asIDBExpected("variable out of scope");
+
+        if (auto varit = stack->scope.local_by_index.find(offset); varit != stack->scope.local_by_index.end())
+            variable = varit->second;
+        else
+            return asIDBExpected("missing local index");
+    }
+    // check this
+    else if (stack && variable_name == "this")
+    {
+        if (stack->scope.this_ptr.expired())
+            return asIDBExpected("not a method");
+
+        variable = stack->scope.this_ptr;
+    }
+    else
+    {
+        struct asIDBNamespacedVar
+        {
+            asIDBVariable::WeakPtr var;
+            std::string_view       name;
+            std::string_view       ns;
+        };
+
+        std::vector<asIDBNamespacedVar> matches;
+        std::string_view                variable_ns;
+
+        if (auto ns_end = variable_name.find_last_of(':'); ns_end != std::string_view::npos)
+        {
+            variable_ns = variable_name.substr(0, ns_end - 1);
+            variable_name = variable_name.substr(ns_end + 1);
+        }
+
+        if (stack)
+        {
+            // not an offset; in order, check the following:
+            // - local variables & function parameters (innermost first)
+            // - class member properties (if appropriate)
+            // - globals
+            if (auto varit = stack->scope.local_by_name.find(variable_name); varit != stack->scope.local_by_name.end())
+                matches.push_back({ varit->second, varit->first });
+
+            // check `this` parameters
+            if (!stack->scope.this_ptr.expired())
+            {
+                auto var = stack->scope.this_ptr.lock();
+                var->Expand();
+                
+                if (auto param = var->FindChild(variable_name))
+                    matches.push_back({ param, param->identifier.name });
+            }
+        }
+
+        // check globals
+        CacheGlobals();
+        
+        if (auto globalit = globals_by_name.find(variable_name); globalit != globals_by_name.end())
+            for (auto &global : globalit->second)
+                if (auto globalp = global.lock())
+                    matches.push_back({ global, globalp->identifier.name, globalp->identifier.ns });
+
+        if (matches.size() == 1)
+            variable = matches[0].var;
+        // if we didn't specify a ns but had multiple
+        // matches, return an error
+        else if (variable_ns.empty())
+            return asIDBExpected(matches.empty() ? "can't find variable" : "ambiguous variable name");
+        else
+        {
+            for (auto &match : matches)
+            {
+                if (variable_ns == match.ns)
+                {
+                    variable = match.var;
+                    break;
+                }
+            }
+        }
+
+        if (!variable)
+            return asIDBExpected("can't find variable");
+    }
+
+    // variable_key should be non-null and with
+    // a valid type ID here.
+    return ResolveSubExpression(variable.value(), variable_end == std::string_view::npos ? std::string_view {}
+                                                                                         : expr.substr(variable_end));
+}
+
+/*virtual*/ asIDBExpected<asIDBVariable::WeakPtr> asIDBCache::ResolveSubExpression(asIDBVariable::WeakPtr var,
+                                                                                   const std::string_view rest)
+{
+    // nothing left, so this is the result.
+    if (rest.empty())
+        return var;
+
+    // make sure we're a type that supports properties
+    auto varp = var.lock();
+
+    varp->Evaluate();
+
+    if (!varp->expandRefId)
+        return asIDBExpected("invalid expression");
+
+    if (auto canonical = varp->alias.lock())
+        varp = canonical;
+
+    varp->Expand();
+
+    if (varp->namedProps.empty() && !varp->GetIndexedCount())
+        return asIDBExpected("no members");
+
+    // check what kind of sub-evaluator to use
+    size_t           eval_start = rest.find_first_of(".[", 1);
+    std::string_view eval_name = rest.substr(0, eval_start);
+
+    if (eval_name[0] == '.')
+        eval_name.remove_prefix(1);
+
+    if (auto child = varp->FindChild(eval_name))
+        return ResolveSubExpression(child, eval_start == std::string_view::npos ? std::string_view {}
+                                                                                : rest.substr(eval_start));
+
+    return asIDBExpected("can't resolve sub-expression");
+}
+
+/*virtual*/ asIDBExpected<asIDBVariable::WeakPtr> asIDBCache::ResolveWatch(std::string_view   expr,
+                                                                           std::optional<int> stack_index)
+{
+    asIDBCallStackEntry *stack = nullptr;
+
+    if (stack_index.has_value())
+    {
+        CacheCallstack(stack_index.value() + 1);
+
+        if ((size_t) stack_index.value() >= call_stack.size())
+            return asIDBExpected("bad stack index");
+
+        stack = &call_stack[stack_index.value()];
+
+        // system functions have no variables
+        if (stack->scope.offset == SCOPE_SYSTEM)
+            stack = nullptr;
+        else
+            stack->scope.Materialize(dbg);
+    }
+
+    asIScriptFunction *function = stack ? stack->scope.function : nullptr;
+    std::string        key(expr);
+    auto               it = watches.find(key);
+
+    // a path is only valid for the function it was compiled in,
+    // since the roots may resolve differently in another frame.
+    if (it == watches.end() || it->second.function != function)
+    {
+        auto path = CompileWatch(expr, stack_index, stack);
+
+        if (!path)
+        {
+            if (it != watches.end())
+                watches.erase(it);
+
+            return ResolveExpression(expr, stack_index);
+        }
+
+        it = watches.insert_or_assign(std::move(key), std::move(path.value())).first;
+    }
+
+    auto &path = it->second;
+
+    if (path.resolved_index == stack_index)
+        if (auto resolved = path.resolved.lock())
+            return path.resolved;
+
+    auto address = FollowWatch(path, stack);
+
+    // the path is stale or went through a null handle;
+    // let the regular resolver handle it (and report the
+    // error, if there is one), and compile it again next time.
+    if (!address)
+    {
+        watches.erase(it);
+        return ResolveExpression(expr, stack_index);
+    }
+
+    auto var = CreateVariable();
+    var->identifier = path.steps.empty() ? path.name : asIDBVarName(path.steps.back().name);
+    // the same expression can mean something else in another frame
+    var->pathHash = stack ? stack->scope.hash : 0;
+    asIDBHashCombine(var->pathHash, expr);
+    var->address = address.value();
+    var->typeName = GetTypeNameFromType({ address->typeId, address->constant ? asTM_CONST : asTM_NONE });
+
+    auto result = ResolveSubExpression(var, path.tail);
+
+    if (result.has_value())
+    {
+        path.resolved = result.value();
+        path.resolved_index = stack_index;
+    }
+
+    return result;
+}
+
+/*virtual*/ std::optional<asIDBWatchPath> asIDBCache::CompileWatch(std::string_view expr, std::optional<int> stack_index,
+                                                                   asIDBCallStackEntry *stack)
+{
+    if (!expr.empty() && (expr[0] == '@' || (expr.size() >= 2 && expr[0] == '&' && !isdigit(expr[1]))))
+        expr.remove_prefix(1);
+
+    size_t variable_end = expr.find_first_of(".[", 0);
+
+    // use the regular resolver for the root, so that
+    // the lookup rules are the same.
+    auto root = ResolveExpression(expr.substr(0, variable_end), stack_index);
+
+    if (!root.has_value())
+        return std::nullopt;
+
+    auto               var = root.value().lock();
+    auto               owner = var->owner.lock();
+    auto               this_ptr = stack ? stack->scope.this_ptr.lock() : nullptr;
+    asIDBWatchPath     path;
+    std::string        rest(variable_end == std::string_view::npos ? std::string_view {} : expr.substr(variable_end));
+
+    path.function = stack ? stack->scope.function : nullptr;
+    path.name = var->identifier;
+    path.typeId = var->address.typeId;
+
+    if (this_ptr && var == this_ptr)
+        path.root = asIDBWatchPath::Root::This;
+    // class members are compiled as steps from `this`
+    else if (this_ptr && owner == this_ptr)
+    {
+        path.root = asIDBWatchPath::Root::This;
+        path.name = this_ptr->identifier;
+        path.typeId = this_ptr->address.typeId;
+        rest = fmt::format(".{}{}", var->identifier.name, rest);
+    }
+    else if (globals && owner == globals)
+    {
+        path.root = asIDBWatchPath::Root::Global;
+        path.global = var;
+    }
+    else if (stack)
+    {
+        auto local = std::find_if(stack->scope.local_by_index.begin(), stack->scope.local_by_index.end(),
+                                  [&var](auto &entry) { return entry.second.lock() == var; });
+
+        if (local == stack->scope.local_by_index.end())
+            return std::nullopt;
+
+        path.root = asIDBWatchPath::Root::Local;
+        path.local = local->first;
+    }
+    else
+        return std::nullopt;
+
+    // compile as many property accesses as we can
+    auto   engine = ctx->GetEngine();
+    int    typeId = path.typeId;
+    size_t pos = 0;
+
+    while (pos < rest.size() && rest[pos] == '.')
+    {
+        size_t           end = rest.find_first_of(".[", pos + 1);
+        std::string_view name = std::string_view(rest).substr(pos + 1, end == std::string::npos ? end : end - pos - 1);
+        auto             type = (typeId & asTYPEID_MASK_OBJECT) ? engine->GetTypeInfoById(typeId) : nullptr;
+        bool             found = false;
+
+        for (asUINT n = 0; type && n < type->GetPropertyCount(); n++)
+        {
+            const char *propName;
+            int         propTypeId;
+            int         offset;
+            int         compositeOffset;
+            bool        isCompositeIndirect;
+            bool        isReadOnly;
+
+            type->GetProperty(n, &propName, &propTypeId, 0, 0, &offset, 0, 0, &compositeOffset, &isCompositeIndirect,
+                              &isReadOnly);
+
+            if (name != propName)
+                continue;
+
+            path.steps.push_back({ std::string(name), propTypeId, isReadOnly, (int) n, offset, compositeOffset,
+                                   isCompositeIndirect });
+            typeId = propTypeId;
+            found = true;
+            break;
+        }
+
+        // getters, etc
+        if (!found)
+            break;
+
+        pos = end == std::string::npos ? rest.size() : end;
+    }
+
+    path.tail = rest.substr(pos);
+    return path;
+}
+
+/*virtual*/ std::optional<asIDBVarAddr> asIDBCache::FollowWatch(const asIDBWatchPath &path, asIDBCallStackEntry *stack)
+{
+    asIDBVarAddr address;
+
+    switch (path.root)
+    {
+    case asIDBWatchPath::Root::Local: {
+        if (!stack || !ctx->IsVarInScope(path.local, stack->scope.offset))
+            return std::nullopt;
+
+        const char      *name;
+        int              typeId;
+        asETypeModifiers modifiers;
+        ctx->GetVar(path.local, stack->scope.offset, &name, &typeId, &modifiers);
+
+        if (typeId != path.typeId)
+            return std::nullopt;
+
+        address = { typeId, (modifiers & asTM_CONST) != 0, ctx->GetAddressOfVar(path.local, stack->scope.offset) };
+        break;
+    }
+    case asIDBWatchPath::Root::This:
+        if (!stack || ctx->GetThisTypeId(stack->scope.offset) != path.typeId)
+            return std::nullopt;
+
+        address = { path.typeId, false, ctx->GetThisPointer(stack->scope.offset) };
+        break;
+    case asIDBWatchPath::Root::Global: {
+        // globals are re-created if any module changes,
+        // in which case this will have expired.
+        auto global = path.global.lock();
+
+        if (!global)
+            return std::nullopt;
+
+        address = global->address;
+        break;
+    }
+    }
+
+    for (auto &step : path.steps)
+    {
+        if (!address.ResolveAs<void>())
+            return std::nullopt;
+
+        address = { step.typeId, step.constant,
+                    ResolvePropertyAddress(address, step.propertyIndex, step.offset, step.compositeOffset,
+                                           step.isCompositeIndirect) };
+    }
+
+    if (!address.address)
+        return std::nullopt;
+
+    return address;
+}
+
+// aborts snippets that run for too long.
+static void asIDBSnippetLineCallback(asIScriptContext *ctx, asUINT *remaining)
+{
+    if (!*remaining)
+        ctx->Abort();
+    else
+        (*remaining)--;
+}
+
+// append the parameter declaration for the given binding;
+// returns false if it can't be passed to a snippet.
+static bool asIDBDeclareSnippetParam(asIScriptEngine *engine, std::string &params, const asIDBSnippetBinding &binding)
+{
+    int         typeId = binding.address.typeId;
+    const char *decl = engine->GetTypeDeclaration(typeId, true);
+
+    if (!decl)
+        return false;
+
+    std::string param;
+
+    if ((typeId & asTYPEID_OBJHANDLE) || !(typeId & asTYPEID_MASK_OBJECT))
+        param = fmt::format("{} {}", decl, binding.name);
+    else if (auto type = engine->GetTypeInfoById(typeId))
+    {
+        if (type->GetFlags() & asOBJ_VALUE)
+            param = fmt::format("const {} &in {}", decl, binding.name);
+        else if (!(type->GetFlags() & asOBJ_NOHANDLE))
+            param = fmt::format("{}@ {}", decl, binding.name);
+        else
+            return false;
+    }
+    else
+        return false;
+
+    if (!params.empty())
+        params += ", ";
+
+    params += param;
+    return true;
+}
+
+// pass the given binding to the snippet parameter; see
+// asIDBDeclareSnippetParam for how they are declared.
+static void asIDBSetSnippetArg(asIScriptContext *ctx, asUINT index, const asIDBVarAddr &address)
+{
+    auto engine = ctx->GetEngine();
+    int  typeId = address.typeId;
+
+    if (typeId & asTYPEID_OBJHANDLE)
+        ctx->SetArgObject(index, *reinterpret_cast<void **>(address.address));
+    else if (typeId & asTYPEID_MASK_OBJECT)
+    {
+        if (engine->GetTypeInfoById(typeId)->GetFlags() & asOBJ_VALUE)
+            ctx->SetArgAddress(index, address.address);
+        else
+            ctx->SetArgObject(index, address.address);
+    }
+    else if (typeId == asTYPEID_FLOAT)
+        ctx->SetArgFloat(index, *address.ResolveAs<float>());
+    else if (typeId == asTYPEID_DOUBLE)
+        ctx->SetArgDouble(index, *address.ResolveAs<double>());
+    else
+    {
+        switch (engine->GetSizeOfPrimitiveType(typeId))
+        {
+        case 1:
+            ctx->SetArgByte(index, *address.ResolveAs<asBYTE>());
+            break;
+        case 2:
+            ctx->SetArgWord(index, *address.ResolveAs<asWORD>());
+            break;
+        case 4:
+            ctx->SetArgDWord(index, *address.ResolveAs<asDWORD>());
+            break;
+        case 8:
+            ctx->SetArgQWord(index, *address.ResolveAs<asQWORD>());
+            break;
+        }
+    }
+}
+
+/*virtual*/ asIDBExpected<asIDBVariable::WeakPtr> asIDBCache::EvaluateSnippet(std::string_view   expr,
+                                                                              std::optional<int> stack_index)
+{
+    asIDBCallStackEntry *stack = nullptr;
+
+    if (stack_index.has_value())
+    {
+        CacheCallstack(stack_index.value() + 1);
+
+        if ((size_t) stack_index.value() >= call_stack.size())
+            return asIDBExpected("bad stack index");
+
+        stack = &call_stack[stack_index.value()];
+
+        // system functions have no variables
+        if (stack->scope.offset == SCOPE_SYSTEM)
+            stack = nullptr;
+        else
+            stack->scope.Materialize(dbg);
+    }
+
+    auto                             engine = ctx->GetEngine();
+    asIScriptFunction               *frame = stack ? stack->scope.function : nullptr;
+    std::vector<asIDBSnippetBinding> bindings;
+    std::string                      params;
+
+    for (auto &binding : GetSnippetBindings(stack))
+        if (asIDBDeclareSnippetParam(engine, params, binding))
+            bindings.push_back(binding);
+
+    // the parameters are part of the key, since the
+    // locals in scope depend on where we are in the function.
+    std::string key = fmt::format("{}\n{}\n{}", (const void *) frame, params, expr);
+    auto        it = dbg.snippets.find(key);
+
+    // the module it was compiled in has been
+    // rebuilt or discarded since.
+    if (it != dbg.snippets.end() && !it->second.IsCurrent())
+    {
+        dbg.snippets_lru.erase(it->second.lru);
+        dbg.snippets.erase(it);
+        it = dbg.snippets.end();
+    }
+
+    if (it == dbg.snippets.end())
+    {
+        it = dbg.snippets.emplace(std::move(key), CompileSnippet(expr, frame, params)).first;
+        it->second.lru = dbg.snippets_lru.insert(dbg.snippets_lru.end(), &it->first);
+
+        while (dbg.snippets.size() > std::max(dbg.snippet_cache_size, (size_t) 1))
+        {
+            auto oldest = dbg.snippets.find(*dbg.snippets_lru.front());
+            dbg.snippets_lru.pop_front();
+            dbg.snippets.erase(oldest);
+        }
+    }
+    else
+        dbg.snippets_lru.splice(dbg.snippets_lru.end(), dbg.snippets_lru, it->second.lru);
+
+    auto &snippet = it->second;
+
+    if (!snippet.function)
+        return asIDBExpected(snippet.error);
+
+    // snippets run on their own context, so the
+    // one being debugged is left alone.
+    if (dbg.snippet_ctx && dbg.snippet_ctx->GetEngine() != engine)
+    {
+        dbg.snippet_ctx->Release();
+        dbg.snippet_ctx = nullptr;
+    }
+
+    if (!dbg.snippet_ctx)
+        dbg.snippet_ctx = engine->CreateContext();
+
+    auto snippet_ctx = dbg.snippet_ctx;
+
+    snippet_ctx->Prepare(snippet.function);
+
+    for (asUINT i = 0; i < bindings.size(); i++)
+        asIDBSetSnippetArg(snippet_ctx, i, bindings[i].address);
+
+    asUINT remaining = dbg.snippet_line_budget;
+    snippet_ctx->SetLineCallback(asFUNCTION(asIDBSnippetLineCallback), &remaining, asCALL_CDECL);
+
+    dbg.internal_execution = true;
+    snippet_ctx->Execute();
+    dbg.internal_execution = false;
 
-        if (m < 0)
-            return asIDBExpected("bad stack index");
+    snippet_ctx->ClearLineCallback();
 
-        if (offset >= (asUINT) m)
-            return asIDBExpected("stack offset out of bounds");
+    auto var = CreateVariable();
+    var->identifier = asIDBVarName(expr);
+    var->pathHash = stack ? stack->scope.hash : 0;
+    asIDBHashCombine(var->pathHash, expr);
 
-        if (!ctx->IsVarInScope(offset, stack_index.value()))
-            return asIDBExpected("variable out of scope");
+    if (snippet_ctx->GetState() == asEXECUTION_FINISHED)
+    {
+        int typeId = snippet.function->GetReturnTypeId();
 
-        if (auto varit = stack->scope.local_by_index.find(offset); varit != stack->scope.local_by_index.end())
-            variable = varit->second;
+        if (typeId == asTYPEID_VOID)
+        {
+            var->value = "(void)";
+            var->evaluated = true;
+        }
         else
-            return asIDBExpected("missing local index");
+        {
+            var->stackValue = asIDBValue(engine, snippet_ctx->GetAddressOfReturnValue(), typeId, false);
+            var->address = { typeId, false, var->stackValue.GetPointer<void>(true) };
+            var->typeName = GetTypeNameFromType({ typeId, asTM_NONE });
+        }
     }
-    // check this
-    else if (stack && variable_name == "this")
+    else if (snippet_ctx->GetState() == asEXECUTION_EXCEPTION)
     {
-        if (stack->scope.this_ptr.expired())
-            return asIDBExpected("not a method");
-
-        variable = stack->scope.this_ptr;
+        var->SetValue(fmt::format("Exception thrown ({})", snippet_ctx->GetExceptionString()));
+        var->evaluated = true;
     }
     else
     {
-        struct asIDBNamespacedVar
-        {
-            asIDBVariable::WeakPtr var;
-            std::string_view       name;
-            std::string_view       ns;
-        };
-
-        std::vector<asIDBNamespacedVar> matches;
-        std::string_view                variable_ns;
+        var->value = "(timed out)";
+        var->evaluated = true;
+    }
 
-        if (auto ns_end = variable_name.find_last_of(':'); ns_end != std::string_view::npos)
-        {
-            variable_ns = variable_name.substr(0, ns_end - 1);
-            variable_name = variable_name.substr(ns_end + 1);
-        }
+    snippet_ctx->Unprepare();
 
-        if (stack)
-        {
-            // not an offset; in order, check the following:
-            // - local variables (in reverse order)
-            // - function parameters
-            // - class member properties (if appropriate)
-            // - globals
-            for (int i = ctx->GetVarCount(stack_index.value()) - 1; i >= 0; i--)
-            {
-                if (!ctx->IsVarInScope(i, stack_index.value()))
-                    continue;
+    return asIDBVariable::WeakPtr(var);
+}
 
-                const char      *name;
-                int              typeId;
-                asETypeModifiers modifiers;
-                ctx->GetVar(i, stack_index.value(), &name, &typeId, &modifiers);
+/*virtual*/ std::vector<asIDBSnippetBinding> asIDBCache::GetSnippetBindings(asIDBCallStackEntry *stack)
+{
+    std::vector<asIDBSnippetBinding> bindings;
 
-                if (variable_name != name)
-                    continue;
+    if (!stack)
+        return bindings;
 
-                if (auto varit = stack->scope.local_by_index.find(i); varit != stack->scope.local_by_index.end())
-                    matches.push_back({ varit->second, name });
+    // sorted, so that the parameter list is
+    // the same every time.
+    std::map<std::string_view, asIDBVarAddr> visible;
 
-                break;
-            }
+    if (auto this_ptr = stack->scope.this_ptr.lock())
+    {
+        auto type = ctx->GetEngine()->GetTypeInfoById(this_ptr->address.typeId);
 
-            // check `this` parameters
-            if (!stack->scope.this_ptr.expired())
-            {
-                auto var = stack->scope.this_ptr.lock();
-                var->Expand();
-                
-                for (auto &param : var->namedProps)
-                    if (variable_name == param->identifier.name)
-                        matches.push_back({ param, param->identifier.name });
-                for (auto &param : var->indexedProps)
-                    if (variable_name == param->identifier.name)
-                        matches.push_back({ param, param->identifier.name });
-            }
+        for (asUINT n = 0; n < type->GetPropertyCount(); n++)
+        {
+            const char *name;
+            int         propTypeId;
+            int         offset;
+            int         compositeOffset;
+            bool        isCompositeIndirect;
+            bool        isReadOnly;
+
+            type->GetProperty(n, &name, &propTypeId, 0, 0, &offset, 0, 0, &compositeOffset, &isCompositeIndirect,
+                              &isReadOnly);
+
+            visible.insert_or_assign(name, asIDBVarAddr { propTypeId, isReadOnly,
+                                                          ResolvePropertyAddress(this_ptr->address, n, offset,
+                                                                                 compositeOffset,
+                                                                                 isCompositeIndirect) });
         }
+    }
 
-        // check globals
-        CacheGlobals();
-        
-        for (auto &global : globals->namedProps)
-            if (variable_name == global->identifier.name)
-                matches.push_back({ global, global->identifier.name, global->identifier.ns });
-        for (auto &global : globals->indexedProps)
-            if (variable_name == global->identifier.name)
-                matches.push_back({ global, global->identifier.name, global->identifier.ns });
+    for (auto &[name, local] : stack->scope.local_by_name)
+        if (auto var = local.lock())
+            visible.insert_or_assign(name, var->address);
 
-        if (matches.size() == 1)
-            variable = matches[0].var;
-        // if we didn't specify a ns but had multiple
-        // matches, return an error
-        else if (variable_ns.empty())
-            return asIDBExpected(matches.empty() ? "can't find variable" : "ambiguous variable name");
-        else
-        {
-            for (auto &match : matches)
-            {
-                if (variable_ns == match.ns)
-                {
-                    variable = match.var;
-                    break;
-                }
-            }
-        }
+    bindings.reserve(visible.size());
 
-        if (!variable)
-            return asIDBExpected("can't find variable");
-    }
+    for (auto &[name, address] : visible)
+        if (address.typeId && address.address)
+            bindings.push_back({ name, address });
 
-    // variable_key should be non-null and with
-    // a valid type ID here.
-    return ResolveSubExpression(variable.value(), variable_end == std::string_view::npos ? std::string_view {}
-                                                                                         : expr.substr(variable_end));
+    return bindings;
 }
 
-/*virtual*/ asIDBExpected<asIDBVariable::WeakPtr> asIDBCache::ResolveSubExpression(asIDBVariable::WeakPtr var,
-                                                                                   const std::string_view rest)
+/*virtual*/ asIDBSnippet asIDBCache::CompileSnippet(std::string_view expr, asIScriptFunction *frame,
+                                                    const std::string &params)
 {
-    // nothing left, so this is the result.
-    if (rest.empty())
-        return var;
+    auto             engine = ctx->GetEngine();
+    asIScriptModule *module = frame ? frame->GetModule() : nullptr;
+    asIDBSnippet     snippet(nullptr, frame);
 
-    // make sure we're a type that supports properties
-    auto varp = var.lock();
+    if (!module && engine->GetModuleCount())
+        module = engine->GetModuleByIndex(0);
 
-    varp->Evaluate();
+    snippet.engine = engine;
+    snippet.module = module;
 
-    if (!varp->expandRefId)
-        return asIDBExpected("invalid expression");
+    if (!module)
+    {
+        snippet.error = "no module to evaluate in";
+        return snippet;
+    }
 
-    varp->Expand();
+    // AngelScript can't infer a return type, so find out
+    // what type the expression is with a probe first.
+    asIScriptFunction *probe = nullptr;
+    int                typeId = asTYPEID_VOID;
+    std::string        code = fmt::format("void __asIDB_probe({}) {{ auto __asIDB_result = ({}); }}", params, expr);
 
-    if (varp->namedProps.empty() && varp->indexedProps.empty())
-        return asIDBExpected("no members");
+    if (module->CompileFunction("__asIDB_snippet", code.c_str(), 0, 0, &probe) >= 0)
+    {
+        for (asUINT n = 0; n < probe->GetVarCount(); n++)
+        {
+            const char *name;
+            int         varTypeId;
+            probe->GetVar(n, &name, &varTypeId);
 
-    // check what kind of sub-evaluator to use
-    size_t           eval_start = rest.find_first_of(".[", 1);
-    std::string_view eval_name = rest.substr(0, eval_start);
+            if (name && !strcmp(name, "__asIDB_result"))
+            {
+                typeId = varTypeId;
+                break;
+            }
+        }
 
-    if (eval_name[0] == '.')
-        eval_name.remove_prefix(1);
+        probe->Release();
+    }
+
+    // if the probe didn't compile, it may just be
+    // a void expression (like a function call).
+    if (typeId == asTYPEID_VOID)
+        code = fmt::format("void __asIDB_snippet({}) {{ {}; }}", params, expr);
+    else
+        code = fmt::format("{} __asIDB_snippet({}) {{ return ({}); }}", engine->GetTypeDeclaration(typeId, true),
+                           params, expr);
 
-    for (auto &child : varp->namedProps)
+    if (module->CompileFunction("__asIDB_snippet", code.c_str(), 0, 0, &snippet.function) < 0)
     {
-        if (child->identifier.name == eval_name)
-            return ResolveSubExpression(child, eval_start == std::string_view::npos ? std::string_view {}
-                                                                                    : rest.substr(eval_start));
+        snippet.function = nullptr;
+        snippet.error = "can't compile expression";
     }
 
-    for (auto &child : varp->indexedProps)
+    return snippet;
+}
+
+/*virtual*/ size_t asIDBCache::GetCallstackSize()
+{
+    if (!ctx)
+        return 0;
+
+    if (!call_stack_size.has_value())
     {
-        if (child->identifier.name == eval_name)
-            return ResolveSubExpression(child, eval_start == std::string_view::npos ? std::string_view {}
-                                                                                    : rest.substr(eval_start));
+        call_stack_size = ctx->GetCallstackSize() + (ctx->GetSystemFunction() ? 1 : 0);
+        call_stack_base = dbg.frame_offset.fetch_add(call_stack_size.value());
     }
 
-    return asIDBExpected("can't resolve sub-expression");
+    return call_stack_size.value();
+}
+
+std::optional<size_t> asIDBCache::FindCallstackIndex(int64_t frame_id)
+{
+    size_t size = GetCallstackSize();
+
+    if (frame_id < call_stack_base || frame_id >= call_stack_base + (int64_t) size)
+        return std::nullopt;
+
+    size_t index = (size_t) (frame_id - call_stack_base);
+    CacheCallstack(index + 1);
+    return index;
 }
 
-/*virtual*/ void asIDBCache::CacheCallstack()
+/*virtual*/ void asIDBCache::CacheCallstack(size_t num_frames)
 {
-    if (!ctx || !call_stack.empty())
+    if (!ctx)
+        return;
+
+    num_frames = std::min(num_frames, GetCallstackSize());
+
+    if (call_stack.size() >= num_frames)
         return;
 
-    if (auto sysfunc = ctx->GetSystemFunction())
-        call_stack.emplace_back(asIDBCallStackEntry { dbg.frame_offset++, sysfunc->GetDeclaration(true, false, true),
-                                                      "(system function)", 0, 0,
-                                                      asIDBScope(SCOPE_SYSTEM, dbg, sysfunc) });
+    // reserve the whole thing so that entries never move
+    call_stack.reserve(GetCallstackSize());
 
-    for (asUINT n = 0; n < ctx->GetCallstackSize(); n++)
+    auto   sysfunc = ctx->GetSystemFunction();
+    asUINT sysOffset = sysfunc ? 1 : 0;
+
+    for (size_t i = call_stack.size(); i < num_frames; i++)
     {
+        int64_t id = call_stack_base + (int64_t) i;
+
+        if (sysfunc && i == 0)
+        {
+            call_stack.emplace_back(asIDBCallStackEntry { id, sysfunc->GetDeclaration(true, false, true),
+                                                          "(system function)", 0, 0,
+                                                          asIDBScope(SCOPE_SYSTEM, sysfunc) });
+            continue;
+        }
+
+        asUINT             n = (asUINT) i - sysOffset;
         asIScriptFunction *func = nullptr;
         int                column = 0;
         const char        *section = "";
@@ -509,8 +1903,8 @@ void *asIDBCache::ResolvePropertyAddress(const asIDBVarAddr &id, int propertyInd
             decl = "???"; // FIXME: why does this happen?
 
         call_stack.push_back(
-            asIDBCallStackEntry { dbg.frame_offset++, std::move(decl), section, row, column,
-                                  asIDBScope(func->GetFuncType() == asFUNC_SYSTEM ? SCOPE_SYSTEM : n, dbg, func) });
+            asIDBCallStackEntry { id, std::move(decl), section, row, column,
+                                  asIDBScope((!func || func->GetFuncType() == asFUNC_SYSTEM) ? SCOPE_SYSTEM : n, func) });
     }
 }
 
@@ -518,6 +1912,117 @@ void *asIDBCache::ResolvePropertyAddress(const asIDBVarAddr &id, int propertyInd
 // being replaced by this one.
 /*virtual*/ void asIDBCache::Restore(asIDBCache &cache)
 {
+    // type IDs are only unique to their engine, so
+    // there's nothing we can safely keep otherwise.
+    if (!ctx || !cache.ctx || ctx->GetEngine() != cache.ctx->GetEngine())
+        return;
+
+    // nodes are moved as-is, so any views into
+    // the names stay valid.
+    type_names.merge(cache.type_names);
+
+    // values only need to be compared with the break just before.
+    previous_value_hashes = std::move(cache.value_hashes);
+
+    // watches are re-validated when they are followed,
+    // but anything they resolved to belongs to the old break.
+    watches = std::move(cache.watches);
+
+    for (auto &[expr, path] : watches)
+    {
+        path.resolved.reset();
+        path.resolved_index.reset();
+    }
+
+    // the globals themselves only change if a module
+    // is rebuilt, so keep the structure as long as nothing has
+    // changed; only the values need to be re-evaluated.
+    if (!cache.globals || !cache.globals->expanded || globals)
+        return;
+
+    if (!(cache.globals_key == CalculateGlobalsKey()))
+    {
+        // a module was rebuilt or discarded, so types
+        // resolved before may not be around any more.
+        dbg.InvalidateTypes(ctx->GetEngine());
+        return;
+    }
+
+    globals = std::move(cache.globals);
+    globals_key = std::move(cache.globals_key);
+    globals_by_name = std::move(cache.globals_by_name);
+    variables.insert(globals);
+
+    globals->expandRefId.reset();
+    globals->memoryUsage = globals->valueUsage = 0;
+    UpdateMemoryUsage(*globals);
+
+    auto reset = [this](const asIDBVariable::Ptr &global) {
+        global->evaluated = global->expandable = global->expanded = false;
+        global->countCapped = global->truncated = false;
+        global->value = {};
+        global->indexedCount.reset();
+        global->valueHash.reset();
+        global->forEachIndex = -1;
+        global->forEachCount.reset();
+        global->expandRefId.reset();
+        global->alias.reset();
+        global->lruEntry.reset();
+        global->ClearChildren();
+        global->memoryUsage = global->valueUsage = 0;
+        UpdateMemoryUsage(*global);
+        variables.insert(global);
+    };
+
+    for (auto &global : globals->namedProps)
+        reset(global);
+    for (auto &global : globals->indexedProps)
+        reset(global);
+
+    if (!globals->namedProps.empty() ||
+        !globals->indexedProps.empty())
+        globals->SetRefId();
+}
+
+/*virtual*/ asIDBGlobalsKey asIDBCache::CalculateGlobalsKey() const
+{
+    asIDBGlobalsKey key {};
+
+    if (!ctx)
+        return key;
+
+    key.engine = ctx->GetEngine();
+    key.properties = key.engine->GetGlobalPropertyCount();
+
+    for (asUINT m = 0; m < key.engine->GetModuleCount(); m++)
+    {
+        asIScriptModule *module = key.engine->GetModuleByIndex(m);
+        asUINT           count = module->GetGlobalVarCount();
+        size_t           signature = 0;
+
+        // a module rebuilt in place can end up with the same
+        // number of globals, or even re-use their memory, so
+        // every global is part of the key.
+        for (asUINT n = 0; n < count; n++)
+        {
+            const char *name;
+            const char *nameSpace;
+            int         typeId;
+            bool        isConst;
+
+            module->GetGlobalVar(n, &name, &nameSpace, &typeId, &isConst);
+
+            asIDBHashCombine(signature, std::string_view(name ? name : ""));
+            asIDBHashCombine(signature, std::string_view(nameSpace ? nameSpace : ""));
+            asIDBHashCombine(signature, typeId);
+            asIDBHashCombine(signature, isConst);
+            asIDBHashCombine(signature, module->GetAddressOfGlobalVar(n));
+        }
+
+        key.modules.push_back({ module, count, signature });
+    }
+
+    return key;
 }
 
 /*virtual*/ void asIDBCache::CacheGlobals()
@@ -526,33 +2031,44 @@ void *asIDBCache::ResolvePropertyAddress(const asIDBVarAddr &id, int propertyInd
         return;
 
     if (!globals)
+    {
         globals = CreateVariable();
+        globals->pathHash = std::hash<std::string_view>()("globals");
+    }
 
     if (globals->expanded)
         return;
 
-    auto main = ctx->GetFunction(0)->GetModule();
+    auto engine = ctx->GetEngine();
+
+    globals_key = CalculateGlobalsKey();
 
-    for (asUINT n = 0; n < main->GetGlobalVarCount(); n++)
+    for (asUINT m = 0; m < engine->GetModuleCount(); m++)
     {
-        const char *name;
-        const char *nameSpace;
-        int         typeId;
-        void       *ptr;
-        bool        isConst;
+        asIScriptModule *module = engine->GetModuleByIndex(m);
 
-        main->GetGlobalVar(n, &name, &nameSpace, &typeId, &isConst);
-        ptr = main->GetAddressOfGlobalVar(n);
+        for (asUINT n = 0; n < module->GetGlobalVarCount(); n++)
+        {
+            const char *name;
+            const char *nameSpace;
+            int         typeId;
+            void       *ptr;
+            bool        isConst;
 
-        asIDBTypeId            typeKey { typeId, isConst ? asTM_CONST : asTM_NONE };
-        const std::string_view viewType = GetTypeNameFromType(typeKey);
+            module->GetGlobalVar(n, &name, &nameSpace, &typeId, &isConst);
+            ptr = module->GetAddressOfGlobalVar(n);
 
-        asIDBVarAddr idKey { typeId, isConst, ptr };
+            asIDBTypeId            typeKey { typeId, isConst ? asTM_CONST : asTM_NONE };
+            const std::string_view viewType = GetTypeNameFromType(typeKey);
+
+            asIDBVarAddr idKey { typeId, isConst, ptr };
 
-        globals->CreateChildVariable(asIDBVarName((nameSpace && nameSpace[0]) ? nameSpace : "", name), idKey, viewType);
+            globals->CreateChildVariable(asIDBVarName((nameSpace && nameSpace[0]) ? nameSpace : "", name), idKey,
+                                         viewType);
+        }
     }
 
-    for (asUINT n = 0; n < main->GetEngine()->GetGlobalPropertyCount(); n++)
+    for (asUINT n = 0; n < engine->GetGlobalPropertyCount(); n++)
     {
         const char *name;
         const char *nameSpace;
@@ -560,20 +2076,28 @@ void *asIDBCache::ResolvePropertyAddress(const asIDBVarAddr &id, int propertyInd
         void       *ptr;
         bool        isConst;
 
-        main->GetEngine()->GetGlobalPropertyByIndex(n, &name, &nameSpace, &typeId, &isConst, nullptr, &ptr);
+        engine->GetGlobalPropertyByIndex(n, &name, &nameSpace, &typeId, &isConst, nullptr, &ptr);
 
         asIDBTypeId            typeKey { typeId, isConst ? asTM_CONST : asTM_NONE };
         const std::string_view viewType = GetTypeNameFromType(typeKey);
 
         asIDBVarAddr idKey { typeId, isConst, ptr };
 
-        std::string localName = (nameSpace && nameSpace[0]) ? fmt::format("{}::{}", nameSpace, name) : name;
-
-        globals->CreateChildVariable(std::move(localName), idKey, viewType);
+        globals->CreateChildVariable(asIDBVarName((nameSpace && nameSpace[0]) ? nameSpace : "", name), idKey,
+                                     viewType);
     }
 
+    globals->SortChildren();
+    EvaluatePlainChildren(*globals);
     globals->evaluated = globals->expanded = true;
 
+    globals_by_name.clear();
+
+    for (auto &global : globals->namedProps)
+        globals_by_name[global->identifier.name].push_back(global);
+    for (auto &global : globals->indexedProps)
+        globals_by_name[global->identifier.name].push_back(global);
+
     if (!globals->namedProps.empty() ||
         !globals->indexedProps.empty())
         globals->SetRefId();
@@ -599,65 +2123,138 @@ public:
 
 class asIDBEnumTypeEvaluator : public asIDBTypeEvaluator
 {
-public:
-    virtual void Evaluate(asIDBVariable::Ptr var) const override
+    // lookup tables for a single enum type; built
+    // the first time a value of that type is shown.
+    struct Table
     {
-        auto &dbg = var->dbg;
+        bool    is_unsigned;
+        asUINT  size;
+        asQWORD width_mask; // bits that fit in the underlying type
 
-        // for enums where we have a single matched value
-        // just display it directly; it might be a mask but that's OK.
-        auto type = dbg.cache->ctx->GetEngine()->GetTypeInfoById(var->address.typeId);
+        std::unordered_map<asINT64, const char *>     by_value;
+        std::array<const char *, 64>                  bit_names {};
+        std::vector<std::pair<asQWORD, const char *>> masks; // multi-bit values
+    };
 
-        union {
-            asINT64 v = 0;
-            asQWORD uv;
-        };
+    // kept until the engine's types are invalidated,
+    // since a rebuilt module can re-use a type ID.
+    mutable std::mutex                                                            tables_mutex;
+    mutable std::unordered_map<asIScriptEngine *, std::unordered_map<int, Table>> tables;
 
-        switch (type->GetTypedefTypeId())
-        {
-        case asTYPEID_INT8:   v = *var->address.ResolveAs<const int8_t>(); break;
-        case asTYPEID_UINT8:  uv = *var->address.ResolveAs<const uint8_t>(); break;
-        case asTYPEID_INT16:  v = *var->address.ResolveAs<const int16_t>(); break;
-        case asTYPEID_UINT16: uv = *var->address.ResolveAs<const uint16_t>(); break;
-        case asTYPEID_INT32:  v = *var->address.ResolveAs<const int32_t>(); break;
-        case asTYPEID_UINT32: uv = *var->address.ResolveAs<const uint32_t>(); break;
-        case asTYPEID_INT64:  v = *var->address.ResolveAs<const int64_t>(); break;
-        case asTYPEID_UINT64: uv = *var->address.ResolveAs<const uint64_t>(); break;
-        }
+    const Table &GetTable(asITypeInfo *type) const
+    {
+        std::scoped_lock lock(tables_mutex);
+        auto [it, inserted] = tables[type->GetEngine()].try_emplace(type->GetTypeId());
+        Table &table = it->second;
+
+        if (!inserted)
+            return table;
+
+        table.is_unsigned = type->GetTypedefTypeId() >= asTYPEID_UINT8 && type->GetTypedefTypeId() <= asTYPEID_UINT64;
+        table.size = type->GetSize();
+        table.width_mask = table.size >= 8 ? ~0ull : ((1ull << (table.size * 8)) - 1);
+        table.by_value.reserve(type->GetEnumValueCount());
 
         for (asUINT e = 0; e < type->GetEnumValueCount(); e++)
         {
             asINT64     ov = 0;
             const char *name = type->GetEnumValueByIndex(e, &ov);
+            asQWORD     bits = static_cast<asQWORD>(ov) & table.width_mask;
+
+            // only take the first name, just incase
+            // there's later overrides
+            table.by_value.try_emplace(ov, name);
 
-            if (ov == v)
+            if (std::bitset<64>(bits).count() == 1)
             {
-                if (type->GetTypedefTypeId() >= asTYPEID_UINT8 && type->GetTypedefTypeId() <= asTYPEID_UINT64)
+                int p = 0;
+
+                while (!(bits & 1))
                 {
-                    var->value = fmt::format("{} ({})", name, uv);
-                    return;
+                    bits >>= 1;
+                    p++;
                 }
 
-                var->value = fmt::format("{} ({})", name, v);
-                return;
+                if (!table.bit_names[p])
+                    table.bit_names[p] = name;
             }
+            else if (bits)
+                table.masks.emplace_back(bits, name);
         }
 
-        std::bitset<32> bits(v);
+        return table;
+    }
+
+    // read the value as both signed & unsigned.
+    static void ReadValue(const asIDBVariable::Ptr &var, asITypeInfo *type, asINT64 &v, asQWORD &uv)
+    {
+        v = 0;
 
-        if (bits.count() == 1)
+        switch (type->GetTypedefTypeId())
         {
-            if (type->GetTypedefTypeId() >= asTYPEID_UINT8 && type->GetTypedefTypeId() <= asTYPEID_UINT64)
-            {
-                var->value = fmt::format("{}", uv);
-                return;
-            }
+        case asTYPEID_INT8:   v = *var->address.ResolveAs<const int8_t>(); break;
+        case asTYPEID_UINT8:  v = *var->address.ResolveAs<const uint8_t>(); break;
+        case asTYPEID_INT16:  v = *var->address.ResolveAs<const int16_t>(); break;
+        case asTYPEID_UINT16: v = *var->address.ResolveAs<const uint16_t>(); break;
+        case asTYPEID_INT32:  v = *var->address.ResolveAs<const int32_t>(); break;
+        case asTYPEID_UINT32: v = *var->address.ResolveAs<const uint32_t>(); break;
+        case asTYPEID_INT64:  v = *var->address.ResolveAs<const int64_t>(); break;
+        case asTYPEID_UINT64: v = static_cast<asINT64>(*var->address.ResolveAs<const uint64_t>()); break;
+        }
+
+        uv = static_cast<asQWORD>(v);
+    }
+
+    static std::string FormatNumber(const Table &table, bool hex, asINT64 v, asQWORD uv)
+    {
+        if (hex)
+            return fmt::format("0x{:x}", uv & table.width_mask);
+        else if (table.is_unsigned)
+            return fmt::format("{}", uv);
+
+        return fmt::format("{}", v);
+    }
+
+public:
+    virtual bool UsesHex() const override
+    {
+        return true;
+    }
+
+    virtual void Forget(asIScriptEngine *engine) const override
+    {
+        std::scoped_lock lock(tables_mutex);
+        tables.erase(engine);
+    }
+
+    virtual void Evaluate(asIDBVariable::Ptr var) const override
+    {
+        auto &dbg = var->dbg;
+
+        // for enums where we have a single matched value
+        // just display it directly; it might be a mask but that's OK.
+        auto         type = dbg.cache->ctx->GetEngine()->GetTypeInfoById(var->address.typeId);
+        const Table &table = GetTable(type);
+        asINT64      v;
+        asQWORD      uv;
+
+        ReadValue(var, type, v, uv);
+
+        if (auto it = table.by_value.find(v); it != table.by_value.end())
+        {
+            var->SetValue(fmt::format("{} ({})", it->second, FormatNumber(table, var->hex, v, uv)));
+            return;
+        }
+
+        size_t bits = std::bitset<64>(uv & table.width_mask).count();
 
-            var->value = fmt::format("{}", v);
+        if (bits == 1)
+        {
+            var->SetValue(FormatNumber(table, var->hex, v, uv));
             return;
         }
 
-        var->value = fmt::format("{} bits", bits.count());
+        var->SetValue(fmt::format("{} bits", bits));
         var->expandable = true;
     }
 
@@ -667,80 +2264,43 @@ public:
         auto &cache = *dbg.cache;
         auto  type = cache.ctx->GetEngine()->GetTypeInfoById(var->address.typeId);
 
-        union {
-            asINT64 v = 0;
-            asQWORD uv;
-        };
-
-        switch (type->GetTypedefTypeId())
-        {
-        case asTYPEID_INT8:   v = *var->address.ResolveAs<const int8_t>(); break;
-        case asTYPEID_UINT8:  uv = *var->address.ResolveAs<const uint8_t>(); break;
-        case asTYPEID_INT16:  v = *var->address.ResolveAs<const int16_t>(); break;
-        case asTYPEID_UINT16: uv = *var->address.ResolveAs<const uint16_t>(); break;
-        case asTYPEID_INT32:  v = *var->address.ResolveAs<const int32_t>(); break;
-        case asTYPEID_UINT32: uv = *var->address.ResolveAs<const uint32_t>(); break;
-        case asTYPEID_INT64:  v = *var->address.ResolveAs<const int64_t>(); break;
-        case asTYPEID_UINT64: uv = *var->address.ResolveAs<const uint64_t>(); break;
-        }
-
-        {
-            std::string rawValue;
+        const Table &table = GetTable(type);
+        asINT64      v;
+        asQWORD      uv;
 
-            if (type->GetTypedefTypeId() >= asTYPEID_UINT8 && type->GetTypedefTypeId() <= asTYPEID_UINT64)
-                rawValue = fmt::format("{}", uv);
-            else
-                rawValue = fmt::format("{}", v);
+        ReadValue(var, type, v, uv);
 
+        {
             auto child = var->CreateChildVariable("value", {}, "");
-            child->value = std::move(rawValue);
+            child->SetValue(FormatNumber(table, var->hex, v, uv));
             child->evaluated = true;
         }
 
-        // find bit names
-        asINT64                                  ov = 0;
-        std::array<const char *, sizeof(ov) * 8> bit_names {};
+        asQWORD bits = uv & table.width_mask;
 
-        for (asUINT e = 0; e < type->GetEnumValueCount(); e++)
+        // named masks that are entirely set
+        for (auto &[mask, name] : table.masks)
         {
-            const char                 *name = type->GetEnumValueByIndex(e, &ov);
-            std::bitset<sizeof(ov) * 8> obits(ov);
-
-            // skip masks
-            if (obits.count() != 1)
-                continue;
-
-            if (ov & v)
+            if ((bits & mask) == mask)
             {
-                int p = 0;
-
-                while (ov && !(ov & 1))
-                {
-                    ov >>= 1;
-                    p++;
-                }
-
-                // only take the first name, just incase
-                // there's later overrides
-                if (p <= (obits.size() - 1) && !bit_names[p])
-                    bit_names[p] = name;
+                auto child = var->CreateChildVariable(name, {}, "");
+                child->SetValue(var->hex ? fmt::format("0x{:x}", mask) : fmt::format("{}", mask));
+                child->evaluated = true;
             }
         }
 
         // display bits
-        for (asQWORD e = 0; e < bit_names.size(); e++)
+        for (asQWORD e = 0; e < table.bit_names.size(); e++)
         {
-            if (v & (1ull << e))
+            if (bits & (1ull << e))
             {
-                std::string bitEntry;
+                auto child = var->CreateChildVariable(fmt::format("[{:{}}]", e, table.size == 1 ? 1 : 2), {}, "");
 
-                if (bit_names[e])
-                    bitEntry = bit_names[e];
+                if (table.bit_names[e])
+                    child->value = table.bit_names[e];
                 else
-                    bitEntry = fmt::format("{}", 1 << e);
+                    child->SetValue(var->hex ? fmt::format("0x{:x}", 1ull << e) : fmt::format("{}", 1ull << e));
 
-                auto child = var->CreateChildVariable(fmt::format("[{:{}}]", e, type->GetSize() == 1 ? 1 : 2), {}, "");
-                child->value = std::move(bitEntry);
                 child->evaluated = true;
             }
         }
@@ -762,38 +2322,65 @@ public:
 {
     auto &dbg = var->dbg;
     auto &cache = *dbg.cache;
-    auto  ctx = cache.ctx;
-    auto  type = ctx->GetEngine()->GetTypeInfoById(var->address.typeId);
+    auto  engine = cache.ctx->GetEngine();
+    auto  type = engine->GetTypeInfoById(var->address.typeId);
 
     var->expandable = CanExpand(var);
 
-    if (ctx->GetState() != asEXECUTION_EXCEPTION)
-    {
-        asIDBObjectIteratorHelper it(type, var->address.ResolveAs<void>());
+    asIDBObjectIteratorHelper it(type, var->address.ResolveAs<void>());
 
-        if (!it)
+    if (!it)
+    {
+        if (!it.error.empty())
         {
-            if (!it.error.empty())
-            {
-                var->value = std::string(it.error);
-                return;
-            }
+            var->value = it.error;
+            return;
+        }
+
+        if (var->value.empty())
+            var->SetValue(fmt::format("{{{}}}", var->typeName));
+    }
+    else
+    {
+        // containers with random access are windowed, and
+        // can tell us their length without walking it.
+        asIDBObjectIndexHelper indexer(type, var->address.ResolveAs<void>());
+        size_t                 numElements;
 
-            if (var->value.empty())
-                var->value = fmt::format("{{{}}}", var->typeName);
+        dbg.internal_execution = true;
+        if (indexer)
+        {
+            asIDBPooledContext ctx(dbg, engine);
+            dbg.internal_deadline = std::chrono::steady_clock::now() + dbg.internal_budget;
+            numElements = indexer.Length(ctx);
+            var->indexedCount = numElements;
         }
         else
         {
-            dbg.internal_execution = true;
-            size_t numElements = it.CalculateLength(ctx);
-            dbg.internal_execution = false;
-            
-            if (var->value.empty())
-                var->value = fmt::format("{} elements", numElements);
-
-            if (numElements)
-                var->expandable = true;
+            // walking the whole thing just to show a
+            // count is left for when it's expanded; one past
+            // the limit tells us whether there are more.
+            asIDBPooledContext ctx(dbg, engine);
+            dbg.internal_deadline = std::chrono::steady_clock::now() + dbg.internal_budget;
+            numElements = it.CalculateLength(ctx, dbg.element_count_limit + 1);
+            var->countCapped = numElements > dbg.element_count_limit;
+
+            if (!var->countCapped)
+                var->forEachCount = numElements;
+        }
+        dbg.internal_deadline.reset();
+        dbg.internal_execution = false;
+
+        if (var->value.empty())
+        {
+            if (var->countCapped)
+                var->SetValue(fmt::format("{}+ elements", dbg.element_count_limit));
+            else
+                var->SetValue(fmt::format("{} elements", numElements));
         }
+
+        if (numElements)
+            var->expandable = true;
     }
 }
 
@@ -806,6 +2393,51 @@ public:
     QueryVariableForEach(var);
 }
 
+/*virtual*/ void asIDBObjectTypeEvaluator::ExpandWindow(asIDBVariable::Ptr var, size_t start,
+                                                        size_t count) const /*override*/
+{
+    auto &dbg = var->dbg;
+    auto &cache = *dbg.cache;
+    auto  engine = cache.ctx->GetEngine();
+
+    auto                   type = engine->GetTypeInfoById(var->address.typeId);
+    asIDBObjectIndexHelper it(type, var->address.ResolveAs<void>());
+
+    // without random access, the elements
+    // have to be walked to get to the window.
+    if (!it)
+    {
+        QueryVariableForEachWindow(var, var->forEachIndex, start, count);
+        return;
+    }
+
+    asDWORD          returnFlags;
+    int              typeId = it.opIndex->GetReturnTypeId(&returnFlags);
+    std::string_view typeName = cache.GetTypeNameFromType({ typeId, (asETypeModifiers) returnFlags });
+
+    asIDBPooledContext ctx(dbg, engine);
+    dbg.internal_execution = true;
+
+    for (size_t i = start; i < start + count; i++)
+    {
+        if (var->indexedSlots.find(i) != var->indexedSlots.end())
+            continue;
+
+        dbg.internal_deadline = std::chrono::steady_clock::now() + dbg.internal_budget;
+        asIDBValue value = it.At(ctx, i);
+
+        if (!value.IsValid())
+            break;
+
+        auto child = var->CreateIndexedChild(i, { typeId, (returnFlags & asTM_CONST) != 0, nullptr }, typeName);
+        child->stackValue = std::move(value);
+        child->address.address = child->stackValue.GetPointer<void>(true);
+    }
+
+    dbg.internal_deadline.reset();
+    dbg.internal_execution = false;
+}
+
 // convenience function that queries the properties of the given
 // address (and object, if set) of the given type.
 void asIDBObjectTypeEvaluator::QueryVariableProperties(asIDBVariable::Ptr var) const
@@ -900,42 +2532,110 @@ bool asIDBObjectTypeEvaluator::IsCompatibleGetter(asIScriptFunction *function) c
 void asIDBObjectTypeEvaluator::QueryVariableForEach(asIDBVariable::Ptr var, int index) const
 {
     auto &dbg = var->dbg;
-    auto &cache = *dbg.cache;
-    auto  ctx = cache.ctx;
+    auto  engine = dbg.cache->ctx->GetEngine();
 
-    if (ctx->GetState() == asEXECUTION_EXCEPTION)
+    // windowed containers are expanded a window at a time
+    if (var->indexedCount)
         return;
 
-    auto                      type = ctx->GetEngine()->GetTypeInfoById(var->address.typeId);
-
-    dbg.internal_execution = true;
+    auto                      type = engine->GetTypeInfoById(var->address.typeId);
     asIDBObjectIteratorHelper it(type, var->address.ResolveAs<void>());
 
     if (!it)
+        return;
+
+    // count first; containers too big to show at once are
+    // grouped into folders, and their elements are only
+    // created as the folders are opened. Evaluate's count is
+    // used if it got to the end.
+    size_t length;
+
+    if (var->forEachCount)
+        length = var->forEachCount.value();
+    else
     {
+        asIDBPooledContext ctx(dbg, engine);
+        dbg.internal_execution = true;
+        dbg.internal_deadline = std::chrono::steady_clock::now() + dbg.internal_budget;
+        length = it.CalculateLength(ctx);
+        dbg.internal_deadline.reset();
         dbg.internal_execution = false;
-        return;
     }
 
-    ctx->PushState();
+    if (length > dbg.chunk_size)
+    {
+        var->indexedCount = length;
+        var->forEachIndex = index;
+    }
+    else
+        length = QueryVariableForEachWindow(var, index, 0, length);
+
+    // every element has been counted now, so the exact
+    // count is known. Only the count is replaced; anything
+    // after it (like the variable this one aliases) is kept.
+    if (var->countCapped)
+    {
+        std::string      capped = fmt::format("{}+ elements", dbg.element_count_limit);
+        std::string_view value = var->value;
+
+        if (value.substr(0, capped.size()) == capped)
+            var->SetValue(fmt::format("{} elements{}", length, value.substr(capped.size())));
+
+        var->countCapped = false;
+    }
+}
+
+size_t asIDBObjectTypeEvaluator::QueryVariableForEachWindow(asIDBVariable::Ptr var, int index, size_t start,
+                                                            size_t count) const
+{
+    auto &dbg = var->dbg;
+    auto &cache = *dbg.cache;
+    auto  engine = cache.ctx->GetEngine();
+
+    auto                      type = engine->GetTypeInfoById(var->address.typeId);
+    asIDBObjectIteratorHelper it(type, var->address.ResolveAs<void>());
+
+    if (!it)
+        return 0;
+
+    dbg.internal_execution = true;
+
+    // every function gets a context of its own, so that each
+    // one only has to be prepared once for the whole walk.
+    asIDBPooledContext             step_ctx(dbg, engine);
+    asIDBPooledContext             end_ctx(dbg, engine);
+    std::deque<asIDBPooledContext> value_ctxs;
+
+    for (size_t i = 0; i < it.opForValues.size(); i++)
+        value_ctxs.emplace_back(dbg, engine);
+
+    // each step gets a time budget of its own; if the
+    // iterator can't be stepped, the walk ends there.
+    dbg.internal_deadline = std::chrono::steady_clock::now() + dbg.internal_budget;
 
-    auto itValue = it.Begin(ctx);
-    int  elementId = 0;
-    bool multiElement = index == -1 && it.opForValues.size() > 1;
+    auto   itValue = it.Begin(step_ctx);
+    size_t elementId = 0;
+    size_t end = start + std::min(count, std::numeric_limits<size_t>::max() - start);
+    bool   multiElement = index == -1 && it.opForValues.size() > 1;
 
-    while (true)
+    for (; elementId < end; elementId++, itValue = it.Next(step_ctx, itValue))
     {
-        if (it.End(ctx, itValue))
+        dbg.internal_deadline = std::chrono::steady_clock::now() + dbg.internal_budget;
+
+        if (it.End(end_ctx, itValue))
             break;
 
+        if (elementId < start || var->indexedSlots.find(elementId) != var->indexedSlots.end())
+            continue;
+
         asIDBVariable::Ptr indexVar;
 
         // if we're a multi-element, the root is fake
         // and just exists to store the element id.
         if (multiElement)
         {
-            indexVar = var->CreateChildVariable(fmt::format("[{}]", elementId), {},
-                                                "" // FIXME: could show types as tuple?
+            indexVar = var->CreateIndexedChild(elementId, {},
+                                               "" // FIXME: could show types as tuple?
             );
             indexVar->expanded = indexVar->evaluated = true;
         }
@@ -943,86 +2643,257 @@ void asIDBObjectTypeEvaluator::QueryVariableForEach(asIDBVariable::Ptr var, int
         for (int offset = (index == -1 ? 0 : index), visibleOffset = 0;
              offset < (index == -1 ? it.opForValues.size() : index + 1); offset++, visibleOffset++)
         {
-            it.Value(ctx, itValue, offset);
-
-            asDWORD    returnFlags;
-            int        typeId = it.opForValues[offset]->GetReturnTypeId(&returnFlags);
-            asIDBValue returnValue(ctx->GetEngine(), ctx->GetAddressOfReturnValue(), typeId,
-                                   (returnFlags & asTM_INOUTREF) != 0);
-
-            auto child =
-                (multiElement ? indexVar : var)
-                    ->CreateChildVariable(fmt::format("[{}]", multiElement ? visibleOffset : elementId),
-                                          { typeId, (returnFlags & asTM_CONST) != 0, nullptr },
-                                          dbg.cache->GetTypeNameFromType({ typeId, (asETypeModifiers) returnFlags }));
-            child->stackValue = std::move(returnValue);
-            child->address.address = child->stackValue.GetPointer<void>(true);
-        }
+            asIScriptContext *ctx = value_ctxs[offset];
+            asDWORD          returnFlags;
+            int              typeId = it.opForValues[offset]->GetReturnTypeId(&returnFlags);
+            asIDBVarAddr     address { typeId, (returnFlags & asTM_CONST) != 0, nullptr };
+            std::string_view typeName = cache.GetTypeNameFromType({ typeId, (asETypeModifiers) returnFlags });
+            bool             finished = it.Value(ctx, itValue, offset);
+
+            auto child = multiElement
+                             ? indexVar->CreateChildVariable(fmt::format("[{}]", visibleOffset), address, typeName)
+                             : var->CreateIndexedChild(elementId, address, typeName);
+
+            if (!finished)
+            {
+                // a suspended context can't be prepared again
+                // for the next element until it's aborted.
+                if (ctx->GetState() == asEXECUTION_SUSPENDED)
+                {
+                    ctx->Abort();
+                    child->value = "(timed out)";
+                }
+                else
+                    child->value = "(exception thrown)";
 
-        itValue = it.Next(ctx, itValue);
+                child->evaluated = true;
+                continue;
+            }
 
-        elementId++;
+            child->stackValue =
+                asIDBValue(engine, ctx->GetAddressOfReturnValue(), typeId, (returnFlags & asTM_INOUTREF) != 0, true);
+            child->address.address = child->stackValue.GetPointer<void>(true);
+        }
     }
 
-    ctx->PopState();
-    cache.dbg.internal_execution = false;
+    dbg.internal_deadline.reset();
+    dbg.internal_execution = false;
+
+    return elementId;
 }
 
-const asIDBTypeEvaluator &asIDBCache::GetEvaluator(const asIDBVarAddr &id) const
+/*virtual*/ const asIDBTypeEvaluator &asIDBCache::GetEvaluator(const asIDBVarAddr &id) const
 {
     // the only way the base address is null is if
     // it's uninitialized.
-    static constexpr const asIDBUninitTypeEvaluator uninitType;
-    static constexpr const asIDBNullTypeEvaluator   nullType;
+    static const asIDBUninitTypeEvaluator uninitType;
+    static const asIDBNullTypeEvaluator   nullType;
 
     if (id.address == nullptr)
         return uninitType;
     else if (id.ResolveAs<void>() == nullptr)
         return nullType;
 
-    auto type = ctx->GetEngine()->GetTypeInfoById(id.typeId);
+    return dbg.evaluators.Resolve(ctx->GetEngine(), id.typeId);
+}
 
-    // we'll use the fall back evaluators.
-    // check primitives first.
-#define CHECK_PRIMITIVE_EVAL(asTypeId, cTypeName)                                                                      \
-    if (id.typeId == asTypeId)                                                                                         \
+// the fall back evaluators, shared by every registry.
+static const asIDBUninitTypeEvaluator  fallbackUninitType;
+static const asIDBEnumTypeEvaluator    fallbackEnumType;
+static const asIDBFuncDefTypeEvaluator fallbackFuncdefType;
+static const asIDBObjectTypeEvaluator  fallbackObjectType;
+
+asIDBEvaluatorRegistry::asIDBEvaluatorRegistry()
+{
+    // the built-in primitive evaluators.
+#define REGISTER_PRIMITIVE_EVAL(asTypeId, cTypeName)                                                                   \
     {                                                                                                                  \
-        static constexpr const asIDBPrimitiveTypeEvaluator<cTypeName> cTypeName##Type;                                 \
-        return cTypeName##Type;                                                                                        \
+        static const asIDBPrimitiveTypeEvaluator<cTypeName> cTypeName##Type;                                           \
+        primitives[asTypeId] = &cTypeName##Type;                                                                       \
     }
 
-    CHECK_PRIMITIVE_EVAL(asTYPEID_BOOL, bool);
-    CHECK_PRIMITIVE_EVAL(asTYPEID_INT8, int8_t);
-    CHECK_PRIMITIVE_EVAL(asTYPEID_INT16, int16_t);
-    CHECK_PRIMITIVE_EVAL(asTYPEID_INT32, int32_t);
-    CHECK_PRIMITIVE_EVAL(asTYPEID_INT64, int64_t);
-    CHECK_PRIMITIVE_EVAL(asTYPEID_UINT8, uint8_t);
-    CHECK_PRIMITIVE_EVAL(asTYPEID_UINT16, uint16_t);
-    CHECK_PRIMITIVE_EVAL(asTYPEID_UINT32, uint32_t);
-    CHECK_PRIMITIVE_EVAL(asTYPEID_UINT64, uint64_t);
-    CHECK_PRIMITIVE_EVAL(asTYPEID_FLOAT, float);
-    CHECK_PRIMITIVE_EVAL(asTYPEID_DOUBLE, double);
+    REGISTER_PRIMITIVE_EVAL(asTYPEID_BOOL, bool);
+    REGISTER_PRIMITIVE_EVAL(asTYPEID_INT8, int8_t);
+    REGISTER_PRIMITIVE_EVAL(asTYPEID_INT16, int16_t);
+    REGISTER_PRIMITIVE_EVAL(asTYPEID_INT32, int32_t);
+    REGISTER_PRIMITIVE_EVAL(asTYPEID_INT64, int64_t);
+    REGISTER_PRIMITIVE_EVAL(asTYPEID_UINT8, uint8_t);
+    REGISTER_PRIMITIVE_EVAL(asTYPEID_UINT16, uint16_t);
+    REGISTER_PRIMITIVE_EVAL(asTYPEID_UINT32, uint32_t);
+    REGISTER_PRIMITIVE_EVAL(asTYPEID_UINT64, uint64_t);
+    REGISTER_PRIMITIVE_EVAL(asTYPEID_FLOAT, float);
+    REGISTER_PRIMITIVE_EVAL(asTYPEID_DOUBLE, double);
+
+#undef REGISTER_PRIMITIVE_EVAL
+}
+
+void asIDBEvaluatorRegistry::Register(asIScriptEngine *engine, int typeId,
+                                      std::unique_ptr<asIDBTypeEvaluator> evaluator)
+{
+    typeId &= ~(asTYPEID_OBJHANDLE | asTYPEID_HANDLETOCONST);
 
-#undef CHECK_PRIMITIVE_EVAL
+    const asIDBTypeEvaluator *ptr = evaluators.emplace_back(std::move(evaluator)).get();
 
-    if (type->GetFlags() & asOBJ_ENUM)
+    if (typeId <= asTYPEID_DOUBLE)
+        primitives[typeId] = ptr;
+    else
+        by_type_id[engine][typeId] = ptr;
+
+    // anything we've resolved may be stale now
+    resolved.clear();
+    resolved_engine = nullptr;
+    resolved_types = nullptr;
+}
+
+void asIDBEvaluatorRegistry::Register(std::string_view name, std::unique_ptr<asIDBTypeEvaluator> evaluator)
+{
+    by_name[std::string(name)] = evaluators.emplace_back(std::move(evaluator)).get();
+
+    resolved.clear();
+    resolved_engine = nullptr;
+    resolved_types = nullptr;
+}
+
+const asIDBTypeEvaluator &asIDBEvaluatorRegistry::Resolve(asIScriptEngine *engine, int typeId)
+{
+    typeId &= ~(asTYPEID_OBJHANDLE | asTYPEID_HANDLETOCONST);
+
+    if (typeId <= asTYPEID_DOUBLE && primitives[typeId])
+        return *primitives[typeId];
+
+    if (engine != resolved_engine)
     {
-        static constexpr const asIDBEnumTypeEvaluator enumType;
-        return enumType;
+        resolved_engine = engine;
+        resolved_types = &resolved[engine];
     }
-    else if (type->GetFlags() & asOBJ_FUNCDEF)
+
+    if (auto it = resolved_types->find(typeId); it != resolved_types->end())
+        return *it->second;
+
+    const asIDBTypeEvaluator &evaluator = ResolveType(engine, typeId);
+    resolved_types->emplace(typeId, &evaluator);
+    return evaluator;
+}
+
+void asIDBEvaluatorRegistry::Invalidate(asIScriptEngine *engine)
+{
+    resolved.erase(engine);
+    resolved_engine = nullptr;
+    resolved_types = nullptr;
+
+    for (auto &evaluator : evaluators)
+        evaluator->Forget(engine);
+
+    fallbackEnumType.Forget(engine);
+}
+
+void asIDBEvaluatorRegistry::Forget(asIScriptEngine *engine)
+{
+    Invalidate(engine);
+    by_type_id.erase(engine);
+}
+
+const asIDBTypeEvaluator &asIDBEvaluatorRegistry::ResolveType(asIScriptEngine *engine, int typeId)
+{
+    // exact type ID matches first
+    if (auto engine_types = by_type_id.find(engine); engine_types != by_type_id.end())
+        if (auto it = engine_types->second.find(typeId); it != engine_types->second.end())
+            return *it->second;
+
+    auto type = engine->GetTypeInfoById(typeId);
+
+    if (!type)
+        return fallbackUninitType;
+
+    if (!by_name.empty())
     {
-        static constexpr const asIDBFuncDefTypeEvaluator funcdefType;
-        return funcdefType;
+        // full declaration, ie `array<int>`
+        if (auto it = by_name.find(engine->GetTypeDeclaration(typeId, true)); it != by_name.end())
+            return *it->second;
+
+        // then the base name, which is shared between template instances
+        std::string name = type->GetName();
+
+        if (const char *ns = type->GetNamespace(); ns && *ns)
+            name = fmt::format("{}::{}", ns, name);
+
+        if (auto it = by_name.find(name); it != by_name.end())
+            return *it->second;
     }
 
+    // we'll use the fall back evaluators.
+    if (type->GetFlags() & asOBJ_ENUM)
+        return fallbackEnumType;
+    else if (type->GetFlags() & asOBJ_FUNCDEF)
+        return fallbackFuncdefType;
+
     // finally, just return the base one.
-    static constexpr const asIDBObjectTypeEvaluator objectType;
-    return objectType;
+    return fallbackObjectType;
+}
+
+// defined down here since plain types are the ones
+// only the fall back object evaluator would show.
+const asIDBCache::PlainLayout *asIDBCache::GetPlainLayout(int typeId)
+{
+    typeId &= ~(asTYPEID_OBJHANDLE | asTYPEID_HANDLETOCONST);
+
+    if (auto it = plain_layouts.find(typeId); it != plain_layouts.end())
+        return it->second.get();
+
+    // reserved first, so a type that (indirectly)
+    // contains itself doesn't recurse forever.
+    plain_layouts.emplace(typeId, nullptr);
+
+    auto engine = ctx->GetEngine();
+    auto type = engine->GetTypeInfoById(typeId);
+
+    if (!type || (type->GetFlags() & (asOBJ_ENUM | asOBJ_FUNCDEF)) ||
+        &dbg.evaluators.Resolve(engine, typeId) != &fallbackObjectType)
+        return nullptr;
+
+    // anything that runs script to be shown isn't plain.
+    if (type->GetMethodByName("opForBegin"))
+        return nullptr;
+
+    for (asUINT n = 0; n < type->GetMethodCount(); n++)
+    {
+        asIScriptFunction *function = type->GetMethodByIndex(n, true);
+
+        // same test as asIDBObjectTypeEvaluator::IsCompatibleGetter
+        if (function->IsReadOnly() && function->IsProperty() && function->GetParamCount() == 0)
+            return nullptr;
+    }
+
+    auto layout = std::make_unique<PlainLayout>();
+    layout->fields.reserve(type->GetPropertyCount());
+
+    for (asUINT n = 0; n < type->GetPropertyCount(); n++)
+    {
+        PlainLayout::Field field {};
+
+        type->GetProperty(n, &field.name, &field.typeId, 0, 0, &field.offset, 0, 0, &field.compositeOffset,
+                          &field.isCompositeIndirect, &field.isReadOnly);
+        field.index = n;
+        field.typeName = GetTypeNameFromType({ field.typeId, field.isReadOnly ? asTM_CONST : asTM_NONE });
+
+        // handles and non-plain objects are left
+        // for Evaluate, like getters are.
+        if (!(field.typeId & asTYPEID_MASK_OBJECT))
+            field.evaluator = &dbg.evaluators.Resolve(engine, field.typeId);
+        else if (!(field.typeId & asTYPEID_OBJHANDLE))
+            field.layout = GetPlainLayout(field.typeId);
+
+        layout->nodes += field.layout ? field.layout->nodes : 1;
+        layout->fields.push_back(field);
+    }
+
+    // the nested lookups may have rehashed the map.
+    auto &entry = plain_layouts[typeId];
+    entry = std::move(layout);
+    return entry.get();
 }
 
 #include <filesystem>
-#include <fstream>
 
 std::string asIDBFileWorkspace::PathToSection(const std::string_view v) const
 {
@@ -1036,78 +2907,162 @@ std::string asIDBFileWorkspace::SectionToPath(const std::string_view v) const
 
 std::string asIDBFileWorkspace::SectionSource(const std::string_view v) const
 {
-    std::filesystem::path p(SectionToPath(v));
-    size_t size = std::filesystem::file_size(p);
-    std::string data(size, '\0');
-    std::ifstream in(p);
-    in.read(data.data(), size);
+    if (auto file = SectionSourceFile(v))
+        return std::string(file->GetText());
 
-    // not sure why this is necessary but here we go
-    if (auto nul = data.find_first_of('\0'))
-        data.erase(nul);
-
-    return data;
+    return {};
 }
 
-void asIDBFileWorkspace::CompileScriptSources()
+/*virtual*/ std::shared_ptr<const asIDBSourceFile> asIDBFileWorkspace::SectionSourceFile(
+    const std::string_view v) const /*override*/
 {
-    for (auto &engine : engines)
-    {
-        for (size_t i = 0; i < engine->GetModuleCount(); i++)
-        {
-            auto module = engine->GetModuleByIndex(i);
+    std::string     path = SectionToPath(v);
+    std::error_code ec, size_ec;
+    auto            mtime = std::filesystem::last_write_time(path, ec);
+    auto            size = std::filesystem::file_size(path, size_ec);
 
-            for (size_t f = 0; f < module->GetFunctionCount(); f++)
-                AddSection(module->GetFunctionByIndex(f)->GetScriptSectionName());
-        }
+    std::scoped_lock lock(sources_mutex);
+
+    if (ec || size_ec)
+    {
+        sources.erase(path);
+        return nullptr;
     }
+
+    // the size is checked too, since file times can
+    // be too coarse to catch quick successive writes.
+    if (auto it = sources.find(path); it != sources.end() && it->second.mtime == mtime && it->second.size == size)
+        return it->second.file;
+
+    auto file = asIDBSourceFile::Load(path);
+
+    if (file)
+        sources.insert_or_assign(path, CachedSource { file, mtime, size });
+    else
+        sources.erase(path);
+
+    return file;
 }
 
-void asIDBFileWorkspace::CompileBreakpointPositions()
+void asIDBFileWorkspace::CompileModules()
 {
-    potential_breakpoints.clear();
+    std::vector<asIScriptModule *> modules;
+
+    for (auto &engine : engines)
+        for (asUINT i = 0; i < engine->GetModuleCount(); i++)
+            modules.push_back(engine->GetModuleByIndex(i));
 
-    auto addFunctionBreakpointLocations = [&](asIScriptFunction *func)
+    // every module is indexed into flat vectors of its own,
+    // which are sorted by the worker and merged at the end.
+    struct ModuleIndex
     {
-        for (asUINT i = 0; i < func->GetLineNumberCount(); i++)
-        {
-            const char *section;
-            int         line, col;
-            func->GetLineNumber(i, &section, &line, &col);
-            potential_breakpoints[section].insert(asIDBLineCol { line, col });
-        }
+        std::vector<const char *>                                        sections;
+        std::unordered_map<std::string_view, std::vector<asIDBLineCol>> positions;
     };
 
-    for (auto &engine : engines)
-    {
-        for (size_t i = 0; i < engine->GetModuleCount(); i++)
+    std::vector<ModuleIndex> indices(modules.size());
+
+    asIDBWorkerPool::Shared().Run(modules.size(), [&](size_t m) {
+        ModuleIndex               &index = indices[m];
+        const char                *last_section = nullptr;
+        std::vector<asIDBLineCol> *last_positions = nullptr;
+
+        auto addFunction = [&](asIScriptFunction *func)
         {
-            asIScriptModule *module = engine->GetModuleByIndex(i);
+            if (!func)
+                return;
 
-            for (size_t f = 0; f < module->GetFunctionCount(); f++)
-                addFunctionBreakpointLocations(module->GetFunctionByIndex(f));
+            if (const char *section = func->GetScriptSectionName())
+                index.sections.push_back(section);
 
-            for (size_t t = 0; t < module->GetObjectTypeCount(); t++)
+            for (asUINT i = 0; i < func->GetLineNumberCount(); i++)
             {
-                asITypeInfo *type = module->GetObjectTypeByIndex(t);
+                const char *section;
+                int         line, col;
+                func->GetLineNumber(i, &section, &line, &col);
+
+                if (!section)
+                    continue;
 
-                for (size_t m = 0; m < type->GetMethodCount(); m++)
-                    addFunctionBreakpointLocations(type->GetMethodByIndex(m, false));
+                // lines of a function are nearly always
+                // in the same section as the last one.
+                if (section != last_section)
+                {
+                    last_section = section;
+                    last_positions = &index.positions[section];
+                }
+
+                last_positions->push_back(asIDBLineCol { line, col });
+            }
+        };
+
+        asIScriptModule *module = modules[m];
+
+        for (asUINT f = 0; f < module->GetFunctionCount(); f++)
+            addFunction(module->GetFunctionByIndex(f));
+
+        for (asUINT t = 0; t < module->GetObjectTypeCount(); t++)
+        {
+            asITypeInfo *type = module->GetObjectTypeByIndex(t);
+
+            for (asUINT f = 0; f < type->GetMethodCount(); f++)
+                addFunction(type->GetMethodByIndex(f, false));
+
+            for (asUINT f = 0; f < type->GetBehaviourCount(); f++)
+                addFunction(type->GetBehaviourByIndex(f, nullptr));
+
+            for (asUINT f = 0; f < type->GetFactoryCount(); f++)
+                addFunction(type->GetFactoryByIndex(f));
+        }
+
+        std::sort(index.sections.begin(), index.sections.end());
+        index.sections.erase(std::unique(index.sections.begin(), index.sections.end()), index.sections.end());
+
+        for (auto &[section, positions] : index.positions)
+        {
+            std::sort(positions.begin(), positions.end());
+            positions.erase(std::unique(positions.begin(), positions.end()), positions.end());
+        }
+    });
+
+    potential_breakpoints.clear();
+
+    for (auto &index : indices)
+    {
+        for (const char *section : index.sections)
+            AddSection(section);
 
-                for (size_t m = 0; m < type->GetBehaviourCount(); m++)
-                    addFunctionBreakpointLocations(type->GetBehaviourByIndex(m, nullptr));
+        for (auto &[section, positions] : index.positions)
+        {
+            auto &merged = potential_breakpoints[section];
 
-                for (size_t m = 0; m < type->GetFactoryCount(); m++)
-                    addFunctionBreakpointLocations(type->GetFactoryByIndex(m));
+            if (merged.empty())
+            {
+                merged = std::move(positions);
+                continue;
             }
+
+            // the same section can be in more than one module
+            size_t middle = merged.size();
+            merged.insert(merged.end(), positions.begin(), positions.end());
+            std::inplace_merge(merged.begin(), merged.begin() + middle, merged.end());
+            merged.erase(std::unique(merged.begin(), merged.end()), merged.end());
         }
     }
 }
 
 /*static*/ void asIDBDebugger::LineCallback(asIScriptContext *ctx, asIDBDebugger *debugger)
 {
+    // internal calls (getters, etc) are suspended
+    // if they run for too long.
     if (debugger->internal_execution)
+    {
+        if (debugger->internal_deadline.has_value() &&
+            std::chrono::steady_clock::now() >= debugger->internal_deadline.value())
+            ctx->Suspend();
+
         return;
+    }
 
     // we might not have an action - functions called from within
     // the debugger will never have this set.
@@ -1185,6 +3140,82 @@ void asIDBFileWorkspace::CompileBreakpointPositions()
         debugger->DebugBreak(ctx);
 }
 
+/*static*/ void asIDBDebugger::PooledLineCallback(asIScriptContext *ctx, asIDBDebugger *debugger)
+{
+    if (debugger->internal_deadline.has_value() &&
+        std::chrono::steady_clock::now() >= debugger->internal_deadline.value())
+        ctx->Suspend();
+}
+
+asIScriptContext *asIDBDebugger::AcquireContext(asIScriptEngine *engine)
+{
+    auto &contexts = context_pool[engine];
+
+    if (contexts.empty())
+    {
+        asIScriptContext *ctx = engine->CreateContext();
+        ctx->SetLineCallback(asFUNCTION(asIDBDebugger::PooledLineCallback), this, asCALL_CDECL);
+        return ctx;
+    }
+
+    asIScriptContext *ctx = contexts.back();
+    contexts.pop_back();
+    return ctx;
+}
+
+void asIDBDebugger::ReleaseContext(asIScriptContext *ctx)
+{
+    // contexts that ran out of time are still suspended
+    if (ctx->GetState() == asEXECUTION_SUSPENDED)
+        ctx->Abort();
+
+    ctx->Unprepare();
+
+    auto &contexts = context_pool[ctx->GetEngine()];
+
+    // nested walks can have more out at once than
+    // are worth keeping around.
+    if (contexts.size() >= context_pool_size)
+        ctx->Release();
+    else
+        contexts.push_back(ctx);
+}
+
+/*virtual*/ void asIDBDebugger::InvalidateTypes(asIScriptEngine *engine)
+{
+    std::scoped_lock lock(mutex);
+    evaluators.Invalidate(engine);
+
+    // snippets may refer to functions & globals that are gone.
+    for (auto it = snippets.begin(); it != snippets.end();)
+    {
+        if (it->second.engine != engine)
+        {
+            ++it;
+            continue;
+        }
+
+        snippets_lru.erase(it->second.lru);
+        it = snippets.erase(it);
+    }
+}
+
+/*virtual*/ void asIDBDebugger::ForgetEngine(asIScriptEngine *engine)
+{
+    std::scoped_lock lock(mutex);
+    InvalidateTypes(engine);
+    evaluators.Forget(engine);
+    workspace->engines.erase(engine);
+
+    if (auto it = context_pool.find(engine); it != context_pool.end())
+    {
+        for (auto ctx : it->second)
+            ctx->Release();
+
+        context_pool.erase(it);
+    }
+}
+
 /*static*/ void asIDBDebugger::ExceptionCallback(asIScriptContext *ctx, asIDBDebugger *debugger)
 {
     if (!debugger->internal_execution)
@@ -4,6 +4,12 @@
 #pragma once
 
 #include <angelscript.h>
+#include <array>
+#include <charconv>
+#include <chrono>
+#include <filesystem>
+#include <limits>
+#include <list>
 #include <memory>
 #include <mutex>
 #include <optional>
@@ -45,6 +51,54 @@ struct std::hash<asIDBTypeId>
 
 using asIDBTypeNameMap = std::unordered_map<asIDBTypeId, std::string>;
 
+// a getter called on a specific object.
+struct asIDBGetterKey
+{
+    void              *object = nullptr;
+    asIScriptFunction *getter = nullptr;
+
+    constexpr bool operator==(const asIDBGetterKey &other) const
+    {
+        return object == other.object && getter == other.getter;
+    }
+};
+
+template<>
+struct std::hash<asIDBGetterKey>
+{
+    inline std::size_t operator()(const asIDBGetterKey &key) const
+    {
+        size_t h = std::hash<void *>()(key.object);
+        asIDBHashCombine(h, key.getter);
+        return h;
+    }
+};
+
+// identity of an object in memory; the type ID
+// never has handle bits, so a handle and the object
+// it points to share the same key.
+struct asIDBObjectKey
+{
+    void *object = nullptr;
+    int   typeId = 0;
+
+    constexpr bool operator==(const asIDBObjectKey &other) const
+    {
+        return object == other.object && typeId == other.typeId;
+    }
+};
+
+template<>
+struct std::hash<asIDBObjectKey>
+{
+    inline std::size_t operator()(const asIDBObjectKey &key) const
+    {
+        size_t h = std::hash<void *>()(key.object);
+        asIDBHashCombine(h, key.typeId);
+        return h;
+    }
+};
+
 // a reference to a type ID + fixed address somewhere
 // in memory that will always be alive as long as
 // the debugger is currently broken on a frame.
@@ -138,22 +192,13 @@ struct asIDBVariable
     using Vector = std::vector<Ptr>;
     using Map = std::unordered_map<int64_t, WeakPtr>;
     using Set = std::unordered_set<Ptr>;
-
-    struct Less
-    {
-        inline bool operator()(const Ptr &a, const Ptr &b) const
-        {
-            return *a < *b;
-        }
-    };
+    using NameMap = std::unordered_map<std::string, Ptr>;
 
     inline bool operator<(const asIDBVariable &b) const
     {
         return identifier < b.identifier;
     }
 
-    using SortedSet = std::set<Ptr, Less>;
-
     asIDBDebugger &dbg;
     WeakPtr        ptr;
 
@@ -168,12 +213,26 @@ struct asIDBVariable
     asIDBVarAddr address {};
 
     // these are only available after `evaluated` is true.
+    // `value` must point to memory that lives as long as
+    // the cache; use SetValue to copy it into the cache.
     bool             evaluated = false;
     bool             expandable = false;
-    std::string      value;
+    std::string_view value;
     std::string_view typeName;
     asIDBValue       stackValue;
 
+    // whether the value was formatted as hex.
+    bool hex = false;
+
+    // whether the element count in the value stopped at the
+    // debugger's limit; expanding fills in the exact count.
+    bool countCapped = false;
+
+    // whether Evaluate cut the value short because it was
+    // too long to show; the evaluator's EvaluateFull formats
+    // the whole thing when it's asked for.
+    bool truncated = false;
+
     // if it's a getter, this will be set.
     asIScriptFunction *getter = nullptr;
     Ptr                get_evaluated;
@@ -182,10 +241,57 @@ struct asIDBVariable
     // expandable is true.
     std::optional<int64_t> expandRefId {};
 
-    // named properties & indexed variables
-    bool      expanded = false;
-    SortedSet namedProps;
-    Vector    indexedProps;
+    // if another variable already refers to the same
+    // object, this points to it; we share its ref ID,
+    // and expanding us expands it instead.
+    WeakPtr alias;
+
+    // hash of the path to this variable, which stays the
+    // same between breaks; used to track value changes.
+    size_t pathHash = 0;
+
+    // hash of the value as it was evaluated, before anything
+    // was added for display (alias paths, exact counts); values
+    // that are formatted as hex or not are hashed from memory.
+    std::optional<size_t> valueHash;
+
+    // bytes this variable (and its value) was last accounted
+    // for, and its entry in the cache's LRU list if it's expanded.
+    size_t                                       memoryUsage = 0, valueUsage = 0;
+    std::optional<std::list<WeakPtr>::iterator> lruEntry;
+
+    // named properties & indexed variables. named
+    // properties are sorted after expansion.
+    bool   expanded = false;
+    Vector namedProps;
+    Vector indexedProps;
+
+    // if set, indexed variables are only created when they're
+    // asked for (see ExpandWindow); this is how many there are,
+    // `indexedProps` only holds the ones created so far, and
+    // `indexedSlots` maps an index to its slot in it.
+    std::optional<size_t>              indexedCount;
+    std::unordered_map<size_t, size_t> indexedSlots;
+
+    // for containers that can only be walked with opFor*,
+    // which value of each element is shown when a window is
+    // created (-1 for all of them), and the exact number of
+    // elements if Evaluate counted all of them.
+    int                   forEachIndex = -1;
+    std::optional<size_t> forEachCount;
+
+    // virtual folders that the indexed variables of large
+    // containers are grouped into; see CreateChunks. Folders
+    // are owned by their container, and cover the indices
+    // [chunkStart, chunkStart + chunkCount).
+    Vector chunks;
+    size_t chunkStart = 0, chunkCount = 0;
+
+    // index of children by their combined name (`ns::name`); built
+    // on first lookup. Only the first of duplicate names is kept, so
+    // the number of children it was built from is kept separately.
+    NameMap propsByName;
+    size_t  propsByNameSource = 0;
 
     asIDBVariable(asIDBDebugger &dbg) :
         dbg(dbg)
@@ -197,20 +303,85 @@ struct asIDBVariable
     void Evaluate();
     void Expand();
 
+    // set `valueHash` from the current value.
+    void HashValue();
+
+    // copy the given string into the cache's
+    // string arena and use it as our value.
+    void SetValue(std::string_view str);
+
+    // sort the named properties in natural order. this is
+    // done automatically after Expand, but must be done manually
+    // if you're filling in a variable yourself.
+    void SortChildren();
+
+    // find a named property or indexed variable by its
+    // combined name (see asIDBVarName::Combine).
+    Ptr FindChild(std::string_view name);
+
+    // create the indexed variable `[index]`; this must be used
+    // for windowed variables, so that the index is remembered.
+    Ptr CreateIndexedChild(size_t index, asIDBVarAddr address, std::string_view typeName);
+
+    // make sure the indexed variables in [start, start + count)
+    // exist. Only does anything for windowed variables.
+    void ExpandWindow(size_t start, size_t count);
+
+    // the number of indexed variables, including
+    // ones that haven't been created yet.
+    size_t GetIndexedCount() const
+    {
+        return indexedCount.value_or(indexedProps.size());
+    }
+
+    // fetch the indexed variable at the given index,
+    // creating it if need be.
+    Ptr GetIndexed(size_t index);
+
+    // whether there are enough indexed variables that
+    // they should be shown through virtual folders.
+    bool IsChunked() const;
+
+    // create the virtual folders for this container (or
+    // folder). Folders that are small enough pick up the
+    // elements they cover instead.
+    void CreateChunks();
+
+    // remove all of the children of this variable.
+    void ClearChildren();
+
     // normally you don't need to call this directly
     // but if you're manually creating a variable you
     // may need to do this. This marks the object as
     // expandable and sets the ref id.
     void SetRefId();
+
+    // the path to this variable from its scope,
+    // for display purposes.
+    std::string GetPath() const;
+
+    // estimate the bytes used by this variable, not including
+    // its children or its value (which is in the string arena).
+    size_t CalculateMemoryUsage() const;
 };
 
 // a local, fetched from GetVar
 constexpr uint32_t SCOPE_SYSTEM = (uint32_t) -1;
 
-// A scope contains variables.
+// A scope contains variables. The variables are only
+// fetched the first time the scope is materialized, since
+// most frames of a deep stack are never looked at.
 struct asIDBScope
 {
     uint32_t           offset; // offset in stack fetches (GetVar, etc)
+    asIScriptFunction *function;
+    bool               materialized = false;
+
+    // identifies the frame between breaks; the path
+    // hashes of its variables start from this.
+    size_t hash = 0;
+
+    // these are only available after Materialize.
     asIDBVariable::Ptr parameters;
     asIDBVariable::Ptr locals;
     asIDBVariable::Ptr registers; // "temporaries"
@@ -218,10 +389,22 @@ struct asIDBScope
     std::unordered_map<uint32_t, asIDBVariable::WeakPtr> local_by_index;
     asIDBVariable::WeakPtr                               this_ptr;
 
-    asIDBScope(asUINT offset, asIDBDebugger &dbg, asIScriptFunction *function);
+    // named locals & parameters by their plain name;
+    // if a name is shadowed, the innermost one wins.
+    std::unordered_map<std::string_view, asIDBVariable::WeakPtr> local_by_name;
+
+    asIDBScope(asUINT offset, asIScriptFunction *function) :
+        offset(offset),
+        function(function)
+    {
+    }
+
+    // fetch the variables of this scope, if
+    // we haven't already.
+    void Materialize(asIDBDebugger &dbg);
 
 private:
-    void CalcLocals(asIDBDebugger &dbg, asIScriptFunction *function, asIDBVariable::Ptr &container);
+    void CalcLocals(asIDBDebugger &dbg);
 };
 
 struct asIDBCallStackEntry
@@ -235,17 +418,211 @@ struct asIDBCallStackEntry
 
 using asIDBCallStackVector = std::vector<asIDBCallStackEntry>;
 
+// identifies the set of globals that were cached, so that
+// they can be kept between breaks until something is rebuilt.
+struct asIDBGlobalsKey
+{
+    struct Module
+    {
+        asIScriptModule *module;
+        asUINT           count;
+        size_t           signature; // hash of every global's declaration & address
+
+        constexpr bool operator==(const Module &other) const
+        {
+            return module == other.module && count == other.count && signature == other.signature;
+        }
+    };
+
+    asIScriptEngine    *engine = nullptr;
+    asUINT              properties = 0;
+    std::vector<Module> modules;
+
+    inline bool operator==(const asIDBGlobalsKey &other) const
+    {
+        return engine == other.engine && properties == other.properties && modules == other.modules;
+    }
+};
+
+// a watch expression, compiled down to what is needed
+// to find its value again: a root (local, `this` or global)
+// followed by property accesses. Anything that can't be
+// compiled (getters, iterator indices) is kept as a tail
+// that is resolved with ResolveSubExpression.
+struct asIDBWatchPath
+{
+    enum class Root
+    {
+        Local,
+        This,
+        Global
+    };
+
+    struct Step
+    {
+        std::string name;
+        int         typeId;
+        bool        constant;
+        int         propertyIndex;
+        int         offset;
+        int         compositeOffset;
+        bool        isCompositeIndirect;
+    };
+
+    // the frame function this was compiled against;
+    // locals are only valid in the same function.
+    asIScriptFunction *function = nullptr;
+
+    Root                   root = Root::Local;
+    asUINT                 local = 0;
+    asIDBVariable::WeakPtr global;
+    int                    typeId = 0; // type of the root
+    asIDBVarName           name;
+    std::vector<Step>      steps;
+    std::string            tail;
+
+    // the variable this resolved to during
+    // the current break.
+    asIDBVariable::WeakPtr resolved;
+    std::optional<int>     resolved_index;
+};
+
+// an expression compiled into a function that takes the
+// variables visible in a frame as parameters; see
+// asIDBCache::EvaluateSnippet.
+struct asIDBSnippet
+{
+    // the compiled snippet; null if it failed to compile.
+    asIScriptFunction *function = nullptr;
+
+    // the frame function this was compiled for. we
+    // hold a reference so that the key stays unique.
+    asIScriptFunction *frame = nullptr;
+
+    // where this was compiled.
+    asIScriptEngine *engine = nullptr;
+    asIScriptModule *module = nullptr;
+
+    const char *error = nullptr;
+
+    // entry in the debugger's snippet LRU list.
+    std::list<const std::string *>::iterator lru {};
+
+    asIDBSnippet() = default;
+
+    asIDBSnippet(asIScriptFunction *function, asIScriptFunction *frame) :
+        function(function),
+        frame(frame)
+    {
+        if (frame)
+            frame->AddRef();
+    }
+
+    asIDBSnippet(const asIDBSnippet &) = delete;
+    asIDBSnippet &operator=(const asIDBSnippet &) = delete;
+
+    asIDBSnippet(asIDBSnippet &&other) noexcept :
+        function(other.function),
+        frame(other.frame),
+        engine(other.engine),
+        module(other.module),
+        error(other.error),
+        lru(other.lru)
+    {
+        other.function = other.frame = nullptr;
+    }
+
+    asIDBSnippet &operator=(asIDBSnippet &&other) noexcept
+    {
+        std::swap(function, other.function);
+        std::swap(frame, other.frame);
+        std::swap(engine, other.engine);
+        std::swap(module, other.module);
+        std::swap(error, other.error);
+        std::swap(lru, other.lru);
+        return *this;
+    }
+
+    // whether the module this was compiled in is still
+    // loaded, and the frame function still belongs to it.
+    bool IsCurrent() const
+    {
+        if (!module)
+            return true;
+
+        for (asUINT m = 0; m < engine->GetModuleCount(); m++)
+            if (engine->GetModuleByIndex(m) == module)
+                return !frame || frame->GetModule() == module;
+
+        return false;
+    }
+
+    ~asIDBSnippet()
+    {
+        if (function)
+            function->Release();
+        if (frame)
+            frame->Release();
+    }
+};
+
+// a variable that is passed to a snippet.
+struct asIDBSnippetBinding
+{
+    std::string_view name;
+    asIDBVarAddr     address;
+};
+
 // This interface handles evaluation of asIDBVarAddr's.
 // It is used when the debugger wishes to evaluate
 // the value of, or the children/entries of, a var.
 class asIDBTypeEvaluator
 {
 public:
+    virtual ~asIDBTypeEvaluator() { }
+
     // evaluate the given variable.
     virtual void Evaluate(asIDBVariable::Ptr var) const
     {
     }
 
+    // whether the value Evaluate shows depends on `var->hex`;
+    // if so, it is evaluated again when the client changes it.
+    virtual bool UsesHex() const
+    {
+        return false;
+    }
+
+    // drop anything kept about the given engine's types;
+    // called when they are invalidated (see
+    // asIDBEvaluatorRegistry::Invalidate).
+    virtual void Forget(asIScriptEngine *engine) const
+    {
+    }
+
+    // for evaluators that set `var->truncated`, format the
+    // full value. This is only used for copying & the REPL.
+    virtual std::string EvaluateFull(asIDBVariable::Ptr var) const
+    {
+        return std::string(var->value);
+    }
+
+    // for values that can be formatted from memory alone (no
+    // script calls, no cache access), append the formatted value
+    // to `out` and return true. This may be called from worker
+    // threads; if it returns false, Evaluate is used as normal.
+    virtual bool FormatRaw(const asIDBVarAddr &address, bool hex, std::string &out) const
+    {
+        return false;
+    }
+
+    // for variables whose indexed children are created on
+    // demand (`indexedCount` is set), create the ones in
+    // [start, start + count) that don't exist yet.
+    virtual void ExpandWindow(asIDBVariable::Ptr var, size_t start, size_t count) const
+    {
+    }
+
     // for expandable objects, this is called when the
     // debugger requests it be expanded.
     virtual void Expand(asIDBVariable::Ptr var) const
@@ -260,6 +637,17 @@ class asIDBPrimitiveTypeEvaluator : public asIDBTypeEvaluator
 {
 public:
     virtual void Evaluate(asIDBVariable::Ptr var) const override;
+
+    virtual bool UsesHex() const override
+    {
+        return true;
+    }
+
+    virtual bool FormatRaw(const asIDBVarAddr &address, bool hex, std::string &out) const override;
+
+    // format the value into the given buffer, which
+    // must be at least 32 chars; returns the length.
+    static size_t Format(const T &v, bool hex, char *buffer);
 };
 
 class asIDBObjectTypeEvaluator : public asIDBTypeEvaluator
@@ -269,6 +657,8 @@ public:
 
     virtual void Expand(asIDBVariable::Ptr var) const override;
 
+    virtual void ExpandWindow(asIDBVariable::Ptr var, size_t start, size_t count) const override;
+
 protected:
     // convenience function that queries the properties of the given
     // address (and object, if set) of the given type.
@@ -287,8 +677,77 @@ protected:
 
     // convenience function that iterates the opFor* of the given
     // address (and object, if set) of the given type. If positive,
-    // a specific index will be used.
+    // a specific index will be used. Types with `opIndex` and a
+    // length are windowed instead, so this does nothing for them;
+    // so are ones with more elements than the chunk size, which
+    // are then walked a window at a time.
     void QueryVariableForEach(asIDBVariable::Ptr var, int index = -1) const;
+
+    // walk the opFor* of the given variable, creating the elements
+    // in [start, start + count) that don't exist yet; the ones
+    // before `start` are only stepped over. Returns how many
+    // elements were walked.
+    size_t QueryVariableForEachWindow(asIDBVariable::Ptr var, int index, size_t start, size_t count) const;
+};
+
+// registry of type evaluators. This is what the built-in
+// GetEvaluator uses to dispatch; evaluators can be registered
+// against a type ID, a type declaration (`array<int>`) or a type
+// name, which matches every instance of a template (`array`
+// matches `array<int>`, `array<string>`, etc). Names may be
+// qualified with a namespace. Whatever a type ID resolves to is
+// cached, so after the first lookup dispatch is a single
+// array or hash lookup.
+class asIDBEvaluatorRegistry
+{
+public:
+    asIDBEvaluatorRegistry();
+
+    // register an evaluator for a specific type ID. Object
+    // type IDs are engine-specific; primitive type IDs are
+    // registered for every engine, and `engine` may be null.
+    void Register(asIScriptEngine *engine, int typeId, std::unique_ptr<asIDBTypeEvaluator> evaluator);
+
+    // register an evaluator for a type declaration or name.
+    void Register(std::string_view name, std::unique_ptr<asIDBTypeEvaluator> evaluator);
+
+    // fetch the evaluator for the given type ID. Handle
+    // type IDs resolve to the same evaluator as their type.
+    const asIDBTypeEvaluator &Resolve(asIScriptEngine *engine, int typeId);
+
+    // drop the evaluators resolved for the given engine, so that
+    // its types are looked up again, and have every evaluator
+    // forget what it kept about them; for when modules are rebuilt
+    // or discarded.
+    void Invalidate(asIScriptEngine *engine);
+
+    // drop everything kept for the given engine, including type ID
+    // registrations; for when the engine is destroyed, since another
+    // one may be created at the same address.
+    void Forget(asIScriptEngine *engine);
+
+private:
+    using EvaluatorMap = std::unordered_map<int, const asIDBTypeEvaluator *>;
+
+    // resolve an object type that isn't in the cache yet.
+    const asIDBTypeEvaluator &ResolveType(asIScriptEngine *engine, int typeId);
+
+    // evaluators we own
+    std::vector<std::unique_ptr<asIDBTypeEvaluator>> evaluators;
+
+    // primitives are the same in every engine, so
+    // they are just indexed by their type ID.
+    std::array<const asIDBTypeEvaluator *, asTYPEID_DOUBLE + 1> primitives {};
+
+    // registrations
+    std::unordered_map<asIScriptEngine *, EvaluatorMap>     by_type_id;
+    std::unordered_map<std::string, const asIDBTypeEvaluator *> by_name;
+
+    // resolved evaluators, per engine; the last engine
+    // looked up is kept around since it rarely changes.
+    std::unordered_map<asIScriptEngine *, EvaluatorMap> resolved;
+    asIScriptEngine                                    *resolved_engine = nullptr;
+    EvaluatorMap                                       *resolved_types = nullptr;
 };
 
 // this class holds the cached state of stuff
@@ -313,11 +772,24 @@ public:
     // cache of type id+modifiers to names
     asIDBTypeNameMap type_names;
 
-    // cached call stack
+    // cached call stack; entries are only filled in
+    // on demand, see CacheCallstack.
     asIDBCallStackVector call_stack;
 
-    // cached globals
+    // total number of frames, and the frame ID of the
+    // first one; IDs are reserved for the whole stack up front
+    // so that they can be mapped back to an index directly.
+    std::optional<size_t> call_stack_size;
+    int64_t               call_stack_base = 0;
+
+    // cached globals; these are kept between
+    // breaks by Restore, as long as the key matches.
     asIDBVariable::Ptr globals;
+    asIDBGlobalsKey    globals_key;
+
+    // globals by their plain name; there may be more
+    // than one per name if they are in different namespaces.
+    std::unordered_map<std::string_view, asIDBVariable::WeakVector> globals_by_name;
 
     // cached set of variables
     asIDBVariable::Set variables;
@@ -325,6 +797,88 @@ public:
     // cached map of var IDs to their variable.
     asIDBVariable::Map variable_refs;
 
+    // compiled watch expressions; these are
+    // kept between breaks by Restore.
+    std::unordered_map<std::string, asIDBWatchPath> watches;
+
+    // the first variable that was given a ref ID for
+    // each object; other variables referring to the
+    // same object alias it.
+    std::unordered_map<asIDBObjectKey, asIDBVariable::WeakPtr> objects;
+
+    // results of getters that have been run this break.
+    std::unordered_map<asIDBGetterKey, asIDBVariable::WeakPtr> getter_results;
+
+    // bytes used by the variables of this break, bytes of the
+    // values they hold, and the expanded variables, least recently
+    // used first. The memory actually used is memory_used plus
+    // whatever the string arena holds, which includes values of
+    // variables that were evicted or formatted again since it was
+    // last compacted.
+    size_t                            memory_used = 0;
+    size_t                            value_bytes = 0;
+    std::list<asIDBVariable::WeakPtr> expanded_lru;
+
+    // where to find variables whose ref ID was evicted
+    // from variable_refs; see FindVariable. Named properties
+    // are found by their position in their owner, since names
+    // may be duplicated; the path hash has to match as well.
+    struct EvictedRef
+    {
+        struct Step
+        {
+            asIDBVarName name;
+            size_t       index; // in the owner's namedProps, or npos
+        };
+
+        asIDBVariable::WeakPtr root;
+        std::vector<Step>      path;
+        size_t                 pathHash;
+    };
+
+    std::unordered_map<int64_t, EvictedRef> evicted_refs;
+
+    // next ref ID to hand out; IDs are never re-used
+    // during a break, even if they are evicted.
+    int64_t next_ref_id = 1;
+
+    // storage for variable values.
+    asIDBStringArena strings;
+
+    // if true, integral values are formatted as hex;
+    // set by the client before it requests values.
+    bool hex_values = false;
+
+    // hashes of the values the client has been sent, by
+    // path hash, for this break & the previous one.
+    std::unordered_map<size_t, size_t> value_hashes;
+    std::unordered_map<size_t, size_t> previous_value_hashes;
+
+    // the layout of an object type whose variables can be expanded
+    // without running any script (no getters or opFor*),
+    // so that whole subtrees can be read on the worker pool.
+    struct PlainLayout
+    {
+        struct Field
+        {
+            const char               *name;
+            int                       typeId;
+            bool                      isReadOnly;
+            int                       index, offset, compositeOffset;
+            bool                      isCompositeIndirect;
+            std::string_view          typeName;
+            const asIDBTypeEvaluator *evaluator; // primitives & enums; may fail FormatRaw
+            const PlainLayout        *layout;    // plain objects held by value
+        };
+
+        std::vector<Field> fields;
+        size_t             nodes = 1; // variables in a subtree of this type, including its root
+    };
+
+    // layouts by type ID, built as they're needed; null for
+    // types that aren't plain.
+    std::unordered_map<int, std::unique_ptr<PlainLayout>> plain_layouts;
+
     // ptr back to debugger
     asIDBDebugger &dbg;
 
@@ -345,27 +899,81 @@ public:
     // being replaced by this one.
     virtual void Restore(asIDBCache &cache);
 
-    // caches all of the global properties in the context.
+    // caches all of the global properties in the context's
+    // engine; this covers every module, as well as the
+    // application registered properties.
     virtual void CacheGlobals();
 
-    // cache call stack entries
-    virtual void CacheCallstack();
+    // calculate the key for the globals in the context's engine.
+    virtual asIDBGlobalsKey CalculateGlobalsKey() const;
+
+    // the total number of frames in the call stack.
+    virtual size_t GetCallstackSize();
+
+    // cache call stack entries, up to the given number of frames.
+    virtual void CacheCallstack(size_t num_frames = std::numeric_limits<size_t>::max());
+
+    // find the index into call_stack of the given frame ID;
+    // the entries up to that index will be cached.
+    std::optional<size_t> FindCallstackIndex(int64_t frame_id);
 
     // called when the debugger has broken and it needs
     // to refresh certain cached entries. This will only refresh
     // the state of active entries.
     virtual void Refresh();
 
+    // find the variable with the given ref ID. If its subtree was
+    // evicted, it is expanded again from the nearest root.
+    virtual asIDBVariable::Ptr FindVariable(int64_t ref);
+
+    // re-calculate the memory used by the given variable.
+    void UpdateMemoryUsage(asIDBVariable &var);
+
+    // mark the given expanded variable as the most recently used.
+    void TouchExpanded(const asIDBVariable::Ptr &var);
+
+    // evaluate the children of the given variable that need no
+    // script to run, spread across the debugger's worker pool:
+    // primitives are formatted from memory, and objects with a
+    // plain layout are expanded ahead of time, down to their
+    // primitives. Only used when there's enough work to be worth
+    // it; anything else is left for Evaluate & Expand.
+    virtual void EvaluatePlainChildren(asIDBVariable &var);
+
+    // fetch the layout of the given object type, if it's plain.
+    const PlainLayout *GetPlainLayout(int typeId);
+
+    // evict the least recently expanded subtrees until the memory
+    // used is under the debugger's budget. `keep` and its owners
+    // are never evicted.
+    virtual void EnforceMemoryBudget(const asIDBVariable &keep);
+
+    // remove the children of the given variable, remembering
+    // where their ref IDs pointed to.
+    virtual void EvictChildren(asIDBVariable &var);
+
+    // copy the values of the live variables into a new
+    // string arena, and drop the old one.
+    void CompactStrings();
+
+    // record the value of the given evaluated variable. Returns
+    // true if it was also sent during the previous break, with a
+    // different value.
+    virtual bool TrackValue(const asIDBVariable &var);
+
     // get a safe view into a cached type string.
     virtual const std::string_view GetTypeNameFromType(asIDBTypeId id);
 
     // for the given type + property data, fetch the address of the
-    // value that this property points to.
+    // value that this property points to. This may be called from
+    // worker threads (see EvaluatePlainChildren), so it must only
+    // read memory.
     virtual void *ResolvePropertyAddress(const asIDBVarAddr &id, int propertyIndex, int offset, int compositeOffset,
                                          bool isCompositeIndirect);
 
     // fetch an evaluator for the given resolved address.
-    // the built-in implementation only handles a few base evaluators.
+    // the built-in implementation dispatches through
+    // the debugger's evaluator registry.
     virtual const asIDBTypeEvaluator &GetEvaluator(const asIDBVarAddr &id) const;
 
     // resolve the given expression to a unique var state.
@@ -399,12 +1007,45 @@ public:
     virtual asIDBExpected<asIDBVariable::WeakPtr> ResolveSubExpression(asIDBVariable::WeakPtr var,
                                                                        const std::string_view rest);
 
+    // resolve a watch expression. This accepts the same syntax
+    // as ResolveExpression, but the expression is compiled into
+    // an asIDBWatchPath the first time it is seen, so later
+    // breaks only have to follow the offsets. If the path can't
+    // be followed, this falls back to ResolveExpression.
+    virtual asIDBExpected<asIDBVariable::WeakPtr> ResolveWatch(std::string_view expr, std::optional<int> stack_index);
+
+    // compile the given expression into a watch path, if possible.
+    virtual std::optional<asIDBWatchPath> CompileWatch(std::string_view expr, std::optional<int> stack_index,
+                                                       asIDBCallStackEntry *stack);
+
+    // follow a compiled watch path up to its tail. Returns nothing
+    // if the path is no longer valid or hits a null handle.
+    virtual std::optional<asIDBVarAddr> FollowWatch(const asIDBWatchPath &path, asIDBCallStackEntry *stack);
+
+    // evaluate an arbitrary AngelScript expression in the given
+    // frame. The expression is compiled into a function in the frame's
+    // module (without being added to it), with the locals & members
+    // that are visible in the frame passed in as parameters. Compiled
+    // snippets are cached by the debugger. The snippet is executed on
+    // a separate context, and is aborted if it runs for more than
+    // snippet_line_budget lines.
+    virtual asIDBExpected<asIDBVariable::WeakPtr> EvaluateSnippet(std::string_view expr, std::optional<int> stack_index);
+
+    // gather the variables that a snippet in the given frame
+    // can see. Locals shadow class members.
+    virtual std::vector<asIDBSnippetBinding> GetSnippetBindings(asIDBCallStackEntry *stack);
+
+    // compile a snippet for the given expression, with the
+    // given parameter list.
+    virtual asIDBSnippet CompileSnippet(std::string_view expr, asIScriptFunction *frame, const std::string &params);
+
     // Create a variable container. Generally you don't call
     // this directly, unless you need a blank variable.
     asIDBVariable::Ptr CreateVariable()
     {
         asIDBVariable::Ptr ptr = std::make_shared<asIDBVariable>(dbg);
         ptr->ptr = ptr;
+        UpdateMemoryUsage(*ptr);
         return *variables.emplace(ptr).first;
     }
 };
@@ -438,6 +1079,11 @@ struct asIDBLineCol
     {
         return line == o.line ? col < o.col : line < o.line;
     }
+
+    constexpr bool operator==(const asIDBLineCol &o) const
+    {
+        return line == o.line && col == o.col;
+    }
 };
 
 struct asIDBSource
@@ -476,7 +1122,8 @@ struct asIDBSource
 
 using asIDBSectionSet = std::set<asIDBSource, asIDBSource::LessComparator>;
 using asIDBEngineSet = std::unordered_set<asIScriptEngine *>;
-using asIDBPotentialBreakpointMap = std::unordered_map<std::string_view, std::set<asIDBLineCol, std::less<>>>;
+// positions are sorted & unique.
+using asIDBPotentialBreakpointMap = std::unordered_map<std::string_view, std::vector<asIDBLineCol>>;
 
 // The workspace is contains information about the
 // "project" that the debugger is operating within.
@@ -519,6 +1166,14 @@ public:
 
     // return the full section source of the given section.
     virtual std::string SectionSource(const std::string_view v) const = 0;
+
+    // return the source of the given section along with its
+    // line index, which can be viewed without copying. The
+    // default implementation wraps SectionSource.
+    virtual std::shared_ptr<const asIDBSourceFile> SectionSourceFile(const std::string_view v) const
+    {
+        return asIDBSourceFile::FromString(SectionSource(v));
+    }
 };
 
 // A basic workspace that expects the sources go into
@@ -538,8 +1193,7 @@ public:
             if (engine)
                 this->engines.insert(engine);
 
-        CompileScriptSources();
-        CompileBreakpointPositions();
+        CompileModules();
     }
 
     virtual std::string PathToSection(const std::string_view v) const override;
@@ -552,9 +1206,24 @@ public:
 
     virtual std::string SectionSource(const std::string_view v) const override;
 
+    // sections are read from disk once, and read again
+    // if the file's time or size has changed since.
+    virtual std::shared_ptr<const asIDBSourceFile> SectionSourceFile(const std::string_view v) const override;
+
 private:
-    void CompileScriptSources();
-    void CompileBreakpointPositions();
+    // find the sections & breakpoint positions of every
+    // module; modules are indexed in parallel.
+    void CompileModules();
+
+    struct CachedSource
+    {
+        std::shared_ptr<const asIDBSourceFile> file;
+        std::filesystem::file_time_type        mtime;
+        std::uintmax_t                         size;
+    };
+
+    mutable std::mutex                                    sources_mutex;
+    mutable std::unordered_map<std::string, CachedSource> sources;
 };
 
 using asIDBBreakpointMap = std::unordered_map<std::string_view, asIDBSectionBreakpoints>;
@@ -580,10 +1249,18 @@ public:
     // (used to prevent infinite loops)
     std::atomic_bool internal_execution = false;
 
+    // how long a getter may run before it is suspended,
+    // and when the one that is running now has to finish by.
+    std::chrono::milliseconds                            internal_budget { 250 };
+    std::optional<std::chrono::steady_clock::time_point> internal_deadline;
+
     asIDBWorkspace                 *workspace;
     asIDBBreakpointMap              breakpoints;
     asIDBSectionFunctionBreakpoints function_breakpoints;
 
+    // evaluators used to display variables.
+    asIDBEvaluatorRegistry evaluators;
+
     // cache for the current active broken state.
     // the cache is only kept for the duration of
     // a broken state; resuming in any way destroys
@@ -593,6 +1270,54 @@ public:
     // current frame offset for use by the cache
     std::atomic_int64_t frame_offset = 0;
 
+    // compiled expression snippets, keyed by the frame
+    // function, parameters & expression. Only the most
+    // recently used snippet_cache_size are kept, since each one
+    // keeps a function alive in its module.
+    std::unordered_map<std::string, asIDBSnippet> snippets;
+    std::list<const std::string *>                 snippets_lru;
+    size_t                                         snippet_cache_size = 64;
+
+    // context that snippets are executed on; created
+    // on first use.
+    asIScriptContext *snippet_ctx = nullptr;
+
+    // contexts that other script code the debugger runs (getters,
+    // iteration, lengths) is executed on, so that the context being
+    // debugged is left alone; see AcquireContext. At most
+    // context_pool_size are kept per engine.
+    std::unordered_map<asIScriptEngine *, std::vector<asIScriptContext *>> context_pool;
+    size_t                                                                 context_pool_size = 8;
+
+    // the number of lines a snippet may execute
+    // before it is aborted.
+    asUINT snippet_line_budget = 100000;
+
+    // values longer than this are cut off when they are sent
+    // to the client, unless the full value is asked for.
+    size_t preview_length = 1024;
+
+    // roughly how many bytes the variables of a single
+    // break may use before expanded subtrees are evicted.
+    size_t cache_memory_budget = 64 * 1024 * 1024;
+
+    // workers used to evaluate large expansions, and how many
+    // variables an expansion has to produce before they're used.
+    // Objects with a plain layout are only expanded ahead of
+    // time if they have at most parallel_subtree_limit variables.
+    asIDBWorkerPool &workers = asIDBWorkerPool::Shared();
+    size_t           parallel_threshold = 1024;
+    size_t           parallel_subtree_limit = 64;
+
+    // iterable objects without a native length stop being
+    // counted past this many elements, until expanded.
+    size_t element_count_limit = 1000;
+
+    // containers with more indexed variables than this are
+    // shown through virtual folders of at most this many
+    // entries each, nested as deep as they need to be.
+    size_t chunk_size = 1000;
+
     asIDBDebugger(asIDBWorkspace *workspace) :
         workspace(workspace)
     {
@@ -600,8 +1325,33 @@ public:
 
     virtual ~asIDBDebugger()
     {
+        snippets.clear();
+
+        if (snippet_ctx)
+            snippet_ctx->Release();
+
+        for (auto &[engine, contexts] : context_pool)
+            for (auto ctx : contexts)
+                ctx->Release();
     }
 
+    // take a context from the pool, or create one. Anything run
+    // on it should set `internal_deadline` first.
+    asIScriptContext *AcquireContext(asIScriptEngine *engine);
+
+    // return a context taken from AcquireContext. It's unprepared,
+    // so that it doesn't keep the last call's return value alive.
+    void ReleaseContext(asIScriptContext *ctx);
+
+    // call when modules of the given engine are rebuilt or
+    // discarded; drops anything cached from their types.
+    virtual void InvalidateTypes(asIScriptEngine *engine);
+
+    // call when the given engine is no longer debugged (or is
+    // about to be destroyed); removes it from the workspace and
+    // drops everything cached for it.
+    virtual void ForgetEngine(asIScriptEngine *engine);
+
     // hooks the context onto the debugger; this will
     // reset the cache, and unhook the previous context
     // from the debugger. You'll want to call this if
@@ -649,10 +1399,91 @@ protected:
     
     static void LineCallback(asIScriptContext *ctx, asIDBDebugger *debugger);
     static void ExceptionCallback(asIScriptContext *ctx, asIDBDebugger *debugger);
+    static void PooledLineCallback(asIScriptContext *ctx, asIDBDebugger *debugger);
+};
+
+// a context from the debugger's pool, which is
+// returned to it when this goes out of scope.
+class asIDBPooledContext
+{
+public:
+    asIDBPooledContext(asIDBDebugger &dbg, asIScriptEngine *engine) :
+        dbg(dbg),
+        ctx(dbg.AcquireContext(engine))
+    {
+    }
+
+    asIDBPooledContext(const asIDBPooledContext &) = delete;
+    asIDBPooledContext &operator=(const asIDBPooledContext &) = delete;
+
+    ~asIDBPooledContext()
+    {
+        dbg.ReleaseContext(ctx);
+    }
+
+    operator asIScriptContext *() const
+    {
+        return ctx;
+    }
+    asIScriptContext *operator->() const
+    {
+        return ctx;
+    }
+
+private:
+    asIDBDebugger    &dbg;
+    asIScriptContext *ctx;
 };
 
 template<typename T>
 /*virtual*/ void asIDBPrimitiveTypeEvaluator<T>::Evaluate(asIDBVariable::Ptr var) const /*override*/
 {
-    var->value = fmt::format("{}", *var->address.ResolveAs<const T>());
+    const T &v = *var->address.ResolveAs<const T>();
+
+    if constexpr (std::is_same_v<T, bool>)
+        var->value = v ? "true" : "false";
+    else
+    {
+        // formatted in place, so that large arrays
+        // of primitives don't allocate per element.
+        char buffer[32];
+        var->SetValue({ buffer, Format(v, var->hex, buffer) });
+    }
+}
+
+template<typename T>
+/*virtual*/ bool asIDBPrimitiveTypeEvaluator<T>::FormatRaw(const asIDBVarAddr &address, bool hex,
+                                                          std::string &out) const /*override*/
+{
+    char buffer[32];
+    out.append(buffer, Format(*address.ResolveAs<const T>(), hex, buffer));
+    return true;
+}
+
+template<typename T>
+/*static*/ size_t asIDBPrimitiveTypeEvaluator<T>::Format(const T &v, bool hex, char *buffer)
+{
+    std::to_chars_result result;
+
+    if constexpr (std::is_same_v<T, bool>)
+    {
+        std::string_view str = v ? "true" : "false";
+        std::copy(str.begin(), str.end(), buffer);
+        return str.size();
+    }
+    else if constexpr (std::is_integral_v<T>)
+    {
+        if (hex)
+        {
+            buffer[0] = '0';
+            buffer[1] = 'x';
+            result = std::to_chars(buffer + 2, buffer + 32, static_cast<std::make_unsigned_t<T>>(v), 16);
+        }
+        else
+            result = std::to_chars(buffer, buffer + 32, v);
+    }
+    else
+        result = std::to_chars(buffer, buffer + 32, v);
+
+    return result.ptr - buffer;
 }
\ No newline at end of file
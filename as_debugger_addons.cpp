@@ -0,0 +1,220 @@
+// MIT Licensed
+// see https://github.com/Paril/angelscript-debugger
+
+#include "as_debugger_addons.h"
+#include "scriptany/scriptany.h"
+#include "scriptarray/scriptarray.h"
+#include "scriptdictionary/scriptdictionary.h"
+#include "scriptgrid/scriptgrid.h"
+#include <string>
+
+// append `value` to `out` as the inside of a string literal,
+// escaping quotes, backslashes & control characters. Stops once
+// `out` has grown by `max_length` bytes, but only at the start of
+// a UTF-8 sequence; returns how many bytes of `value` were used.
+static size_t asIDBEscapeString(std::string_view value, std::string &out, size_t max_length = std::string::npos)
+{
+    static constexpr char hex_digits[] = "0123456789abcdef";
+    const size_t          start = out.size();
+    size_t                i = 0;
+
+    for (; i < value.size(); i++)
+    {
+        unsigned char c = static_cast<unsigned char>(value[i]);
+
+        if ((c & 0xC0) != 0x80 && out.size() - start >= max_length)
+            break;
+
+        switch (c)
+        {
+        case '"':  out += "\\\""; break;
+        case '\\': out += "\\\\"; break;
+        case '\n': out += "\\n"; break;
+        case '\r': out += "\\r"; break;
+        case '\t': out += "\\t"; break;
+        default:
+            if (c < 0x20 || c == 0x7F)
+            {
+                out += "\\x";
+                out += hex_digits[c >> 4];
+                out += hex_digits[c & 15];
+            }
+            else
+                out += static_cast<char>(c);
+            break;
+        }
+    }
+
+    return i;
+}
+
+/*virtual*/ void asIDBArrayAddonEvaluator::Evaluate(asIDBVariable::Ptr var) const /*override*/
+{
+    auto  *array = var->address.ResolveAs<CScriptArray>();
+    asUINT size = array->GetSize();
+
+    var->indexedCount = size;
+    var->expandable = size != 0;
+    var->SetValue(fmt::format("{} elements", size));
+}
+
+/*virtual*/ void asIDBArrayAddonEvaluator::ExpandWindow(asIDBVariable::Ptr var, size_t start,
+                                                        size_t count) const /*override*/
+{
+    auto            *array = var->address.ResolveAs<CScriptArray>();
+    int              elementTypeId = array->GetElementTypeId();
+    std::string_view typeName =
+        var->dbg.cache->GetTypeNameFromType({ elementTypeId, var->address.constant ? asTM_CONST : asTM_NONE });
+
+    // the element buffer holds the values of primitives, pointers
+    // to objects and the handles themselves, which is what At
+    // resolves to and what variable addresses expect.
+    for (size_t i = start; i < start + count && i < array->GetSize(); i++)
+        if (var->indexedSlots.find(i) == var->indexedSlots.end())
+            var->CreateIndexedChild(i, { elementTypeId, var->address.constant, array->At((asUINT) i) }, typeName);
+}
+
+/*virtual*/ void asIDBDictionaryAddonEvaluator::Evaluate(asIDBVariable::Ptr var) const /*override*/
+{
+    auto  *dict = var->address.ResolveAs<CScriptDictionary>();
+    asUINT size = dict->GetSize();
+
+    var->expandable = size != 0;
+    var->SetValue(fmt::format("{} elements", size));
+}
+
+/*virtual*/ void asIDBDictionaryAddonEvaluator::Expand(asIDBVariable::Ptr var) const /*override*/
+{
+    auto &cache = *var->dbg.cache;
+    auto *dict = var->address.ResolveAs<CScriptDictionary>();
+
+    // values are stored the same way as in an any; objects
+    // are pointed to, handles & primitives are held inline.
+    for (auto it = dict->begin(); it != dict->end(); it++)
+    {
+        int   typeId = it.GetTypeId();
+        void *value = const_cast<void *>(it.GetAddressOfValue());
+
+        // keys are shown quoted, so that they can't be mistaken
+        // for indices or clash with other names.
+        std::string key = "\"";
+        asIDBEscapeString(it.GetKey(), key);
+        key += '"';
+
+        var->CreateChildVariable(key, { typeId, var->address.constant, value },
+                                 cache.GetTypeNameFromType({ typeId, asTM_NONE }));
+    }
+}
+
+/*virtual*/ void asIDBStringAddonEvaluator::Evaluate(asIDBVariable::Ptr var) const /*override*/
+{
+    const std::string &str = *var->address.ResolveAs<const std::string>();
+
+    // only as much as the client will show is kept in
+    // the cache; the rest is fetched by EvaluateFull.
+    std::string value = "\"";
+    size_t      length = asIDBEscapeString(str, value, var->dbg.preview_length);
+    value += '"';
+
+    var->truncated = length != str.size();
+
+    if (var->truncated)
+        value += fmt::format("\xE2\x80\xA6({} more)", str.size() - length);
+
+    var->SetValue(value);
+}
+
+/*virtual*/ std::string asIDBStringAddonEvaluator::EvaluateFull(asIDBVariable::Ptr var) const /*override*/
+{
+    std::string value = "\"";
+    asIDBEscapeString(*var->address.ResolveAs<const std::string>(), value);
+    value += '"';
+    return value;
+}
+
+// the held value of an any isn't exposed, short of copying
+// it out with Retrieve; this gets at it without a copy.
+struct asIDBAnyAccess : CScriptAny
+{
+    using CScriptAny::value;
+};
+
+static void *asIDBResolveAnyValue(CScriptAny *any)
+{
+    auto &value = any->*(&asIDBAnyAccess::value);
+
+    if ((value.typeId & asTYPEID_MASK_OBJECT) && !(value.typeId & asTYPEID_OBJHANDLE))
+        return value.valueObj;
+
+    return &value.valueInt;
+}
+
+/*virtual*/ void asIDBAnyAddonEvaluator::Evaluate(asIDBVariable::Ptr var) const /*override*/
+{
+    auto *any = var->address.ResolveAs<CScriptAny>();
+    int   typeId = any->GetTypeId();
+
+    if (!typeId)
+    {
+        var->value = "(empty)";
+        return;
+    }
+
+    var->expandable = true;
+    var->SetValue(fmt::format("{{{}}}", var->dbg.cache->GetTypeNameFromType({ typeId, asTM_NONE })));
+}
+
+/*virtual*/ void asIDBAnyAddonEvaluator::Expand(asIDBVariable::Ptr var) const /*override*/
+{
+    auto *any = var->address.ResolveAs<CScriptAny>();
+    int   typeId = any->GetTypeId();
+
+    var->CreateChildVariable("value", { typeId, var->address.constant, asIDBResolveAnyValue(any) },
+                             var->dbg.cache->GetTypeNameFromType({ typeId, asTM_NONE }));
+}
+
+/*virtual*/ void asIDBGridAddonEvaluator::Evaluate(asIDBVariable::Ptr var) const /*override*/
+{
+    auto  *grid = var->address.ResolveAs<CScriptGrid>();
+    asUINT width = grid->GetWidth(), height = grid->GetHeight();
+
+    var->indexedCount = height;
+    var->expandable = width && height;
+    var->SetValue(fmt::format("{}x{} elements", width, height));
+}
+
+/*virtual*/ void asIDBGridAddonEvaluator::ExpandWindow(asIDBVariable::Ptr var, size_t start,
+                                                       size_t count) const /*override*/
+{
+    auto            *grid = var->address.ResolveAs<CScriptGrid>();
+    int              elementTypeId = grid->GetElementTypeId();
+    asUINT           width = grid->GetWidth();
+    std::string_view typeName =
+        var->dbg.cache->GetTypeNameFromType({ elementTypeId, var->address.constant ? asTM_CONST : asTM_NONE });
+
+    // rows are fake, and just exist to hold their elements.
+    for (size_t y = start; y < start + count && y < grid->GetHeight(); y++)
+    {
+        if (var->indexedSlots.find(y) != var->indexedSlots.end())
+            continue;
+
+        auto row = var->CreateIndexedChild(y, {}, "");
+
+        for (asUINT x = 0; x < width; x++)
+            row->CreateIndexedChild(x, { elementTypeId, var->address.constant, grid->At(x, (asUINT) y) }, typeName);
+
+        row->SetValue(fmt::format("{} elements", width));
+        row->evaluated = row->expanded = row->expandable = true;
+        row->SetRefId();
+        var->dbg.cache->UpdateMemoryUsage(*row);
+    }
+}
+
+void asIDBRegisterAddonEvaluators(asIDBEvaluatorRegistry &registry)
+{
+    registry.Register("array", std::make_unique<asIDBArrayAddonEvaluator>());
+    registry.Register("dictionary", std::make_unique<asIDBDictionaryAddonEvaluator>());
+    registry.Register("string", std::make_unique<asIDBStringAddonEvaluator>());
+    registry.Register("any", std::make_unique<asIDBAnyAddonEvaluator>());
+    registry.Register("grid", std::make_unique<asIDBGridAddonEvaluator>());
+}
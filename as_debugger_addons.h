@@ -0,0 +1,63 @@
+// MIT Licensed
+// see https://github.com/Paril/angelscript-debugger
+
+#pragma once
+
+// optional evaluators for the standard AngelScript add-ons
+// (scriptarray, scriptdictionary, scriptstdstring, scriptany &
+// scriptgrid). These read the add-ons' C++ objects directly
+// instead of running script methods on the suspended context,
+// so they need the add-on headers on the include path.
+
+#include "as_debugger.h"
+
+// `array<T>`; elements are windowed, and
+// use the element type's evaluator.
+class asIDBArrayAddonEvaluator : public asIDBTypeEvaluator
+{
+public:
+    virtual void Evaluate(asIDBVariable::Ptr var) const override;
+
+    virtual void ExpandWindow(asIDBVariable::Ptr var, size_t start, size_t count) const override;
+};
+
+// `dictionary`; entries are shown by key.
+class asIDBDictionaryAddonEvaluator : public asIDBTypeEvaluator
+{
+public:
+    virtual void Evaluate(asIDBVariable::Ptr var) const override;
+
+    virtual void Expand(asIDBVariable::Ptr var) const override;
+};
+
+// `string`, as registered by scriptstdstring.
+class asIDBStringAddonEvaluator : public asIDBTypeEvaluator
+{
+public:
+    virtual void Evaluate(asIDBVariable::Ptr var) const override;
+
+    virtual std::string EvaluateFull(asIDBVariable::Ptr var) const override;
+};
+
+// `any`; the held value is shown as a child.
+class asIDBAnyAddonEvaluator : public asIDBTypeEvaluator
+{
+public:
+    virtual void Evaluate(asIDBVariable::Ptr var) const override;
+
+    virtual void Expand(asIDBVariable::Ptr var) const override;
+};
+
+// `grid<T>`; rows are windowed, and each
+// row holds its elements.
+class asIDBGridAddonEvaluator : public asIDBTypeEvaluator
+{
+public:
+    virtual void Evaluate(asIDBVariable::Ptr var) const override;
+
+    virtual void ExpandWindow(asIDBVariable::Ptr var, size_t start, size_t count) const override;
+};
+
+// register all of the above against the type names
+// that the add-ons register by default.
+void asIDBRegisterAddonEvaluators(asIDBEvaluatorRegistry &registry);
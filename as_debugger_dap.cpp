@@ -33,6 +33,7 @@ public:
             response.supportsLoadedSourcesRequest = true;
             response.supportsReadMemoryRequest = true;
             response.supportsExceptionInfoRequest = true;
+            response.supportsValueFormattingOptions = true;
             return response;
         });
 
@@ -71,16 +72,31 @@ public:
             [&](const dap::ResponseOrError<dap::ConfigurationDoneResponse> &response) { OnResponseSent(response); });
     }
     
-    dap::ReadMemoryResponse HandleRequest(const dap::ReadMemoryRequest &request)
+    dap::ResponseOrError<dap::ReadMemoryResponse> HandleRequest(const dap::ReadMemoryRequest &request)
     {
+        std::scoped_lock        lock(dbg->mutex);
         dap::ReadMemoryResponse response {};
 
-        uintptr_t ptr;
+        if (!dbg->cache)
+            return dap::Error("not broken");
+
+        uintptr_t ptr = 0;
         std::from_chars(request.memoryReference.c_str(), request.memoryReference.c_str() + request.memoryReference.size(), ptr);
 
-        asIDBVariable *var = reinterpret_cast<asIDBVariable *>(ptr);
+        // the variable may have been evicted (or be from an
+        // earlier break), so it has to be one the cache still has.
+        asIDBVariable::Ptr key(asIDBVariable::Ptr(), reinterpret_cast<asIDBVariable *>(ptr));
+        auto               found = dbg->cache->variables.find(key);
+
+        if (found == dbg->cache->variables.end())
+            return dap::Error("invalid memoryReference");
+
+        asIDBVariable *var = found->get();
 
         uint8_t *data = var->address.ResolveAs<uint8_t>();
+
+        if (!data)
+            return response;
         // FIXME: engine?
         size_t size = var->address.GetSize(dbg->cache->ctx->GetEngine());
         uint8_t *data_end = data + size;
@@ -305,13 +321,13 @@ public:
             return response;
         }
 
-        dbg->cache->CacheCallstack();
-
         int64_t start = request.startFrame.has_value() ? (int64_t) (*request.startFrame) : (int64_t) 0;
         int64_t levels =
             (request.levels.has_value() && request.levels.value() > 0) ? (int64_t) (*request.levels) : (int64_t) 9999;
 
-        response.totalFrames = dbg->cache->call_stack.size();
+        // only build the frames that were asked for
+        response.totalFrames = dbg->cache->GetCallstackSize();
+        dbg->cache->CacheCallstack((size_t) (start + levels));
 
         for (asUINT i = 0; i < levels && (size_t) (i + start) < dbg->cache->call_stack.size(); i++)
         {
@@ -344,51 +360,47 @@ public:
         if (!dbg->cache)
             return response;
 
-        bool found = false;
+        auto stack_index = dbg->cache->FindCallstackIndex(request.frameId);
+
+        if (!stack_index.has_value())
+            return dap::Error { "invalid stack ID" };
 
         dbg->cache->CacheGlobals();
 
-        for (auto &stack : dbg->cache->call_stack)
-        {
-            if (stack.id != request.frameId)
-                continue;
+        auto &stack = dbg->cache->call_stack[stack_index.value()];
 
-            if (!stack.scope.locals->namedProps.empty() ||
-                !stack.scope.locals->indexedProps.empty())
-            {
-                auto &scope = response.scopes.emplace_back();
-                scope.name = "Locals";
-                scope.presentationHint = "locals";
-                scope.namedVariables = stack.scope.locals->namedProps.size();
-                scope.indexedVariables = stack.scope.locals->indexedProps.size();
-                scope.variablesReference = stack.scope.locals->expandRefId.value();
-            }
-            if (!stack.scope.parameters->namedProps.empty() ||
-                !stack.scope.parameters->indexedProps.empty())
-            {
-                auto &scope = response.scopes.emplace_back();
-                scope.name = "Parameters";
-                scope.presentationHint = "parameters";
-                scope.namedVariables = stack.scope.parameters->namedProps.size();
-                scope.indexedVariables = stack.scope.locals->indexedProps.size();
-                scope.variablesReference = stack.scope.parameters->expandRefId.value();
-            }
-            if (!stack.scope.registers->namedProps.empty() ||
-                !stack.scope.registers->indexedProps.empty())
-            {
-                auto &scope = response.scopes.emplace_back();
-                scope.name = "Registers";
-                scope.presentationHint = "registers";
-                scope.namedVariables = stack.scope.registers->namedProps.size();
-                scope.indexedVariables = stack.scope.locals->indexedProps.size();
-                scope.variablesReference = stack.scope.registers->expandRefId.value();
-            }
-            found = true;
-            break;
-        }
+        stack.scope.Materialize(*dbg);
 
-        if (!found)
-            return dap::Error { "invalid stack ID" };
+        if (!stack.scope.locals->namedProps.empty() ||
+            !stack.scope.locals->indexedProps.empty())
+        {
+            auto &scope = response.scopes.emplace_back();
+            scope.name = "Locals";
+            scope.presentationHint = "locals";
+            scope.namedVariables = stack.scope.locals->namedProps.size();
+            scope.indexedVariables = stack.scope.locals->indexedProps.size();
+            scope.variablesReference = stack.scope.locals->expandRefId.value();
+        }
+        if (!stack.scope.parameters->namedProps.empty() ||
+            !stack.scope.parameters->indexedProps.empty())
+        {
+            auto &scope = response.scopes.emplace_back();
+            scope.name = "Parameters";
+            scope.presentationHint = "parameters";
+            scope.namedVariables = stack.scope.parameters->namedProps.size();
+            scope.indexedVariables = stack.scope.parameters->indexedProps.size();
+            scope.variablesReference = stack.scope.parameters->expandRefId.value();
+        }
+        if (!stack.scope.registers->namedProps.empty() ||
+            !stack.scope.registers->indexedProps.empty())
+        {
+            auto &scope = response.scopes.emplace_back();
+            scope.name = "Registers";
+            scope.presentationHint = "registers";
+            scope.namedVariables = stack.scope.registers->namedProps.size();
+            scope.indexedVariables = stack.scope.registers->indexedProps.size();
+            scope.variablesReference = stack.scope.registers->expandRefId.value();
+        }
 
         if (!dbg->cache->globals->namedProps.empty() ||
             !dbg->cache->globals->indexedProps.empty())
@@ -408,12 +420,14 @@ public:
     dap::ResponseOrError<dap::VariablesResponse> HandleRequest(const dap::VariablesRequest &request)
     {
         std::scoped_lock lock(dbg->mutex);
-        auto             varit = dbg->cache->variable_refs.find(request.variablesReference);
 
-        if (varit == dbg->cache->variable_refs.end())
+        dbg->cache->hex_values = request.format.has_value() && request.format->hex.value_or(false);
+
+        auto varContainer = dbg->cache->FindVariable(request.variablesReference);
+
+        if (!varContainer)
             return dap::Error("invalid variablesReference");
 
-        auto                   varContainer = varit->second.lock();
         dap::VariablesResponse response {};
 
         varContainer->Evaluate();
@@ -434,25 +448,53 @@ public:
             }
             else
             {
-                var.value = local->value.empty() ? local->typeName : local->value;
+                // evaluators that cut values short already kept
+                // them within the preview length.
+                if (local->truncated)
+                    var.value = dap::string(local->value);
+                else
+                    var.value = asIDBPreview(local->value.empty() ? local->typeName : local->value, dbg->preview_length);
+
+                // not a standard attribute, but lets the
+                // client highlight values that changed since the
+                // last break.
+                if (dbg->cache->TrackValue(*local))
+                {
+                    dap::VariablePresentationHint hint {};
+                    hint.attributes = dap::array<dap::string> { "changed" };
+                    var.presentationHint = hint;
+                }
             }
-            var.namedVariables = local->namedProps.size();
-            var.indexedVariables = local->indexedProps.size();
+            // chunked containers show their folders as named variables
+            var.namedVariables = local->namedProps.size() + local->chunks.size();
+            var.indexedVariables = local->IsChunked() ? 0 : local->GetIndexedCount();
             var.variablesReference = local->expandRefId.value_or(0);
             var.memoryReference = fmt::format("{}", reinterpret_cast<uintptr_t>(local->ptr.lock().get()));
         };
 
         if (!request.filter.has_value() || request.filter.value() == "named")
+        {
             for (auto &var : varContainer->namedProps)
                 emplace_var(var);
+            for (auto &var : varContainer->chunks)
+                emplace_var(var);
+        }
         
-        if (!request.filter.has_value() || request.filter.value() == "indexed")
+        if ((!request.filter.has_value() || request.filter.value() == "indexed") && varContainer->chunks.empty())
         {
-            int64_t start = request.start.has_value() ? (int64_t) request.start.value() : 0;
-            int64_t count = request.count.has_value() ? (int64_t) request.count.value() : varContainer->indexedProps.size();
+            size_t total = varContainer->GetIndexedCount();
+            size_t start = std::min(total, request.start.has_value() ? (size_t) request.start.value() : 0);
+            size_t end = total;
+
+            if (request.count.has_value() && request.count.value() > 0)
+                end = std::min(total, start + (size_t) request.count.value());
 
-            for (int64_t i = start; i < count; i++)
-                emplace_var(varContainer->indexedProps[i]);
+            // windowed containers only create the requested elements
+            varContainer->ExpandWindow(start, end - start);
+
+            for (size_t i = start; i < end; i++)
+                if (auto child = varContainer->GetIndexed(i))
+                    emplace_var(child);
         }
 
         return response;
@@ -496,29 +538,51 @@ public:
         if (!dbg->cache)
             return response;
 
+        dbg->cache->hex_values = request.format.has_value() && request.format->hex.value_or(false);
+
         std::optional<int> stack_index = std::nullopt;
 
         if (request.frameId.has_value())
         {
-            for (size_t i = 0; i < dbg->cache->call_stack.size(); i++)
-                if (request.frameId.value() == dbg->cache->call_stack[i].id)
-                {
-                    stack_index = i;
-                    break;
-                }
+            if (auto index = dbg->cache->FindCallstackIndex(request.frameId.value()))
+                stack_index = (int) index.value();
         }
 
-        auto result = dbg->cache->ResolveExpression(request.expression, stack_index);
+        auto result = (request.context.has_value() && request.context.value() == "watch")
+                          ? dbg->cache->ResolveWatch(request.expression, stack_index)
+                          : dbg->cache->ResolveExpression(request.expression, stack_index);
+
+        // anything that isn't a plain variable is compiled & run
+        // as a snippet; hovers are left out, since they fire
+        // constantly and can't have side effects.
+        if (!result.has_value() && request.context.value_or("") != "hover")
+            result = dbg->cache->EvaluateSnippet(request.expression, stack_index);
 
         if (!result.has_value())
-            return dap::Error { result.error().data() };
+            return dap::Error { std::string(result.error()) };
 
         auto var = result.value().lock();
 
         var->Evaluate();
 
         response.type = dap::string(var->typeName);
-        response.result = var->value.empty() ? var->typeName : var->value;
+        // copying & the REPL get the full value; anything
+        // else (watches, hovers) only gets a preview.
+        std::string_view value = var->value.empty() ? var->typeName : var->value;
+
+        if (request.context.value_or("") == "clipboard" || request.context.value_or("") == "repl")
+            response.result = var->truncated ? dbg->cache->GetEvaluator(var->address).EvaluateFull(var) : std::string(value);
+        else if (var->truncated)
+            response.result = dap::string(value);
+        else
+            response.result = asIDBPreview(value, dbg->preview_length);
+
+        if (dbg->cache->TrackValue(*var))
+        {
+            dap::VariablePresentationHint hint {};
+            hint.attributes = dap::array<dap::string> { "changed" };
+            response.presentationHint = hint;
+        }
         response.variablesReference = var->expandRefId.value_or(0);
 
         return response;
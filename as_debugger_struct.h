@@ -0,0 +1,122 @@
+// MIT Licensed
+// see https://github.com/Paril/angelscript-debugger
+
+#pragma once
+
+// evaluators for registered C++ value types whose fields are
+// described once, at compile time. Field offsets come from
+// member pointers and values are formatted with to_chars, so
+// displaying them doesn't go through the type's reflection
+// data at all. Only primitive fields are supported.
+//
+//     debugger->evaluators.Register("vec3_t", asIDBMakeStructEvaluator(
+//         asIDBField("x", &vec3_t::x), asIDBField("y", &vec3_t::y), asIDBField("z", &vec3_t::z)));
+
+#include "as_debugger.h"
+#include <tuple>
+#include <type_traits>
+
+// the AngelScript type ID of the given primitive C++ type.
+template<typename M>
+constexpr int asIDBPrimitiveTypeId()
+{
+    static_assert(std::is_arithmetic_v<M>, "only primitive fields are supported");
+
+    if constexpr (std::is_same_v<M, bool>)
+        return asTYPEID_BOOL;
+    else if constexpr (std::is_floating_point_v<M>)
+        return sizeof(M) == sizeof(float) ? asTYPEID_FLOAT : asTYPEID_DOUBLE;
+    else if constexpr (std::is_signed_v<M>)
+    {
+        constexpr int ids[] = { asTYPEID_INT8, asTYPEID_INT16, 0, asTYPEID_INT32, 0, 0, 0, asTYPEID_INT64 };
+        return ids[sizeof(M) - 1];
+    }
+    else
+    {
+        constexpr int ids[] = { asTYPEID_UINT8, asTYPEID_UINT16, 0, asTYPEID_UINT32, 0, 0, 0, asTYPEID_UINT64 };
+        return ids[sizeof(M) - 1];
+    }
+}
+
+// a single field of T, of type M.
+template<typename T, typename M>
+struct asIDBStructField
+{
+    std::string_view name;
+    M T::*member;
+};
+
+template<typename T, typename M>
+constexpr asIDBStructField<T, M> asIDBField(std::string_view name, M T::*member)
+{
+    return { name, member };
+}
+
+template<typename T, typename... M>
+class asIDBStructTypeEvaluator : public asIDBTypeEvaluator
+{
+public:
+    constexpr asIDBStructTypeEvaluator(asIDBStructField<T, M>... fields) :
+        fields(fields...)
+    {
+    }
+
+    virtual void Evaluate(asIDBVariable::Ptr var) const override
+    {
+        const T    &obj = *var->address.ResolveAs<const T>();
+        std::string str;
+
+        str.reserve(sizeof...(M) * 16);
+        str.push_back('{');
+
+        std::apply([&](const auto &...field) { (Append(str, obj, field, var->hex), ...); }, fields);
+
+        str.push_back('}');
+        var->SetValue(str);
+        var->expandable = true;
+    }
+
+    virtual bool UsesHex() const override
+    {
+        return true;
+    }
+
+    virtual void Expand(asIDBVariable::Ptr var) const override
+    {
+        T &obj = *var->address.ResolveAs<T>();
+
+        std::apply([&](const auto &...field) { (AddChild(var, obj, field), ...); }, fields);
+    }
+
+private:
+    std::tuple<asIDBStructField<T, M>...> fields;
+
+    template<typename F>
+    static void Append(std::string &str, const T &obj, const asIDBStructField<T, F> &field, bool hex)
+    {
+        char buffer[32];
+
+        if (str.size() > 1)
+            str.append(", ");
+
+        str.append(field.name);
+        str.append(": ");
+        str.append(buffer, asIDBPrimitiveTypeEvaluator<F>::Format(obj.*field.member, hex, buffer));
+    }
+
+    template<typename F>
+    static void AddChild(const asIDBVariable::Ptr &var, T &obj, const asIDBStructField<T, F> &field)
+    {
+        constexpr int typeId = asIDBPrimitiveTypeId<F>();
+
+        var->CreateChildVariable(field.name, { typeId, var->address.constant, &(obj.*field.member) },
+                                 var->dbg.cache->GetTypeNameFromType({ typeId, asTM_NONE }));
+    }
+};
+
+// make an evaluator from the given field table.
+template<typename T, typename... M>
+std::unique_ptr<asIDBTypeEvaluator> asIDBMakeStructEvaluator(asIDBStructField<T, M>... fields)
+{
+    return std::make_unique<asIDBStructTypeEvaluator<T, M...>>(fields...);
+}
@@ -2,9 +2,11 @@
 // see https://github.com/Paril/angelscript-debugger
 
 #include "as_helpers.h"
+#include <cstring>
+#include <fstream>
 #include <stdexcept>
 
-asIDBValue::asIDBValue(asIScriptEngine *engine, void *ptr, int typeId, bool reference) :
+asIDBValue::asIDBValue(asIScriptEngine *engine, void *ptr, int typeId, bool reference, bool borrow) :
     engine(engine),
     typeId(typeId)
 {
@@ -26,7 +28,15 @@ asIDBValue::asIDBValue(asIScriptEngine *engine, void *ptr, int typeId, bool refe
     }
     else if (typeId & asTYPEID_MASK_OBJECT)
     {
-        value.obj = engine->CreateScriptObjectCopy(ptr, type);
+        // references point into memory that is kept alive
+        // by something else, so there's no need for a copy.
+        if (reference && borrow)
+        {
+            value.obj = ptr;
+            borrowed = true;
+        }
+        else
+            value.obj = engine->CreateScriptObjectCopy(ptr, type);
     }
     else
     {
@@ -39,7 +49,8 @@ asIDBValue::asIDBValue(asIScriptEngine *engine, void *ptr, int typeId, bool refe
 asIDBValue::asIDBValue(const asIDBValue &other) :
     engine(other.engine),
     typeId(other.typeId),
-    type(other.type)
+    type(other.type),
+    borrowed(other.borrowed)
 {
     if (!typeId)
         return;
@@ -52,6 +63,8 @@ asIDBValue::asIDBValue(const asIDBValue &other) :
         value.obj = other.value.obj;
         engine->AddRefScriptObject(value.obj, type);
     }
+    else if (borrowed)
+        value.obj = other.value.obj;
     else if (typeId & asTYPEID_MASK_OBJECT)
     {
         value.obj = engine->CreateScriptObjectCopy(other.value.obj, type);
@@ -63,7 +76,8 @@ asIDBValue::asIDBValue(const asIDBValue &other) :
 asIDBValue::asIDBValue(asIDBValue &&other) noexcept :
     engine(other.engine),
     typeId(other.typeId),
-    type(other.type)
+    type(other.type),
+    borrowed(other.borrowed)
 {
     if (!typeId)
         return;
@@ -73,6 +87,7 @@ asIDBValue::asIDBValue(asIDBValue &&other) noexcept :
     other.type = nullptr;
     other.typeId = 0;
     other.value.u64 = 0;
+    other.borrowed = false;
 }
 
 asIDBValue &asIDBValue::operator=(const asIDBValue &other)
@@ -80,6 +95,7 @@ asIDBValue &asIDBValue::operator=(const asIDBValue &other)
     engine = other.engine;
     typeId = other.typeId;
     type = other.type;
+    borrowed = other.borrowed;
     value.u64 = 0;
 
     if (!typeId)
@@ -93,6 +109,8 @@ asIDBValue &asIDBValue::operator=(const asIDBValue &other)
         value.obj = other.value.obj;
         engine->AddRefScriptObject(value.obj, type);
     }
+    else if (borrowed)
+        value.obj = other.value.obj;
     else if (typeId & asTYPEID_MASK_OBJECT)
     {
         value.obj = engine->CreateScriptObjectCopy(other.value.obj, type);
@@ -108,6 +126,7 @@ asIDBValue &asIDBValue::operator=(asIDBValue &&other) noexcept
     engine = other.engine;
     typeId = other.typeId;
     type = other.type;
+    borrowed = other.borrowed;
     value.u64 = 0;
 
     if (!typeId)
@@ -118,6 +137,7 @@ asIDBValue &asIDBValue::operator=(asIDBValue &&other) noexcept
     other.type = nullptr;
     other.typeId = 0;
     other.value.u64 = 0;
+    other.borrowed = false;
 
     return *this;
 }
@@ -129,7 +149,7 @@ asIDBValue::~asIDBValue()
 
 void asIDBValue::Release()
 {
-    if (typeId & asTYPEID_MASK_OBJECT)
+    if ((typeId & asTYPEID_MASK_OBJECT) && !borrowed)
         engine->ReleaseScriptObject(value.obj, type);
 
     if (type)
@@ -137,6 +157,7 @@ void asIDBValue::Release()
 
     type = nullptr;
     typeId = 0;
+    borrowed = false;
     value.u64 = 0;
 }
 
@@ -198,27 +219,34 @@ asIDBValue asIDBObjectIteratorHelper::Begin(asIScriptContext *ctx) const
 {
     ctx->Prepare(opForBegin);
     ctx->SetObject(obj);
-    ctx->Execute();
+
+    if (ctx->Execute() != asEXECUTION_FINISHED)
+        return {};
 
     asDWORD flags;
     int typeId = opForBegin->GetReturnTypeId(&flags);
     return asIDBValue(ctx->GetEngine(), ctx->GetAddressOfReturnValue(), typeId, (asETypeModifiers) flags);
 }
 
-void asIDBObjectIteratorHelper::Value(asIScriptContext *ctx, const asIDBValue &val, size_t index) const
+bool asIDBObjectIteratorHelper::Value(asIScriptContext *ctx, const asIDBValue &val, size_t index) const
 {
     ctx->Prepare(opForValues[index]);
     ctx->SetObject(obj);
     val.SetArgument(ctx, 0);
-    ctx->Execute();
+    return ctx->Execute() == asEXECUTION_FINISHED;
 }
 
 asIDBValue asIDBObjectIteratorHelper::Next(asIScriptContext *ctx, const asIDBValue &val) const
 {
+    if (!val.IsValid())
+        return {};
+
     ctx->Prepare(opForNext);
     ctx->SetObject(obj);
     val.SetArgument(ctx, 0);
-    ctx->Execute();
+
+    if (ctx->Execute() != asEXECUTION_FINISHED)
+        return {};
 
     asDWORD flags;
     int typeId = opForBegin->GetReturnTypeId(&flags);
@@ -227,22 +255,26 @@ asIDBValue asIDBObjectIteratorHelper::Next(asIScriptContext *ctx, const asIDBVal
 
 bool asIDBObjectIteratorHelper::End(asIScriptContext *ctx, const asIDBValue &val) const
 {
+    // an iterator we couldn't get is as good as the end
+    if (!val.IsValid())
+        return true;
+
     ctx->Prepare(opForEnd);
     ctx->SetObject(obj);
     val.SetArgument(ctx, 0);
-    ctx->Execute();
+
+    if (ctx->Execute() != asEXECUTION_FINISHED)
+        return true;
+
     return !!ctx->GetReturnByte();
 }
 
-size_t asIDBObjectIteratorHelper::CalculateLength(asIScriptContext *ctx) const
+size_t asIDBObjectIteratorHelper::CalculateLength(asIScriptContext *ctx, size_t limit) const
 {
-    ctx->PushState();
-
     size_t length = 0;
-    for (auto it = Begin(ctx); !End(ctx, it); length++, it = Next(ctx, it))
+    for (auto it = Begin(ctx); length < limit && !End(ctx, it); length++, it = Next(ctx, it))
         ;
 
-    ctx->PopState();
     return length;
 }
 
@@ -271,3 +303,274 @@ bool asIDBObjectIteratorHelper::Validate()
 
     return true;
 }
+
+static bool asIDBIsIntegralTypeId(int typeId)
+{
+    return typeId >= asTYPEID_INT8 && typeId <= asTYPEID_UINT64;
+}
+
+asIDBObjectIndexHelper::asIDBObjectIndexHelper(asITypeInfo *type, void *obj) :
+    type(type),
+    obj(obj)
+{
+    for (asUINT i = 0; i < type->GetMethodCount(); i++)
+    {
+        asIScriptFunction *f = type->GetMethodByIndex(i, true);
+        int                paramTypeId;
+
+        if (strcmp(f->GetName(), "opIndex") || f->GetParamCount() != 1 || !f->GetReturnTypeId())
+            continue;
+
+        f->GetParam(0, &paramTypeId);
+
+        if (!asIDBIsIntegralTypeId(paramTypeId))
+            continue;
+
+        // the const overload is preferred, since
+        // it can't have side effects on the container.
+        if (!opIndex || f->IsReadOnly())
+            opIndex = f;
+    }
+
+    for (const char *name : { "length", "size", "get_length", "get_size" })
+    {
+        asIScriptFunction *f = type->GetMethodByName(name);
+
+        if (f && f->GetParamCount() == 0 && asIDBIsIntegralTypeId(f->GetReturnTypeId()))
+        {
+            length = f;
+            break;
+        }
+    }
+}
+
+size_t asIDBObjectIndexHelper::Length(asIScriptContext *ctx) const
+{
+    ctx->Prepare(length);
+    ctx->SetObject(obj);
+
+    size_t result = 0;
+
+    if (ctx->Execute() == asEXECUTION_FINISHED)
+    {
+        switch (ctx->GetEngine()->GetSizeOfPrimitiveType(length->GetReturnTypeId()))
+        {
+        case 1: result = ctx->GetReturnByte(); break;
+        case 2: result = ctx->GetReturnWord(); break;
+        case 4: result = ctx->GetReturnDWord(); break;
+        default: result = ctx->GetReturnQWord(); break;
+        }
+    }
+
+    return result;
+}
+
+asIDBValue asIDBObjectIndexHelper::At(asIScriptContext *ctx, size_t index) const
+{
+    int paramTypeId;
+    opIndex->GetParam(0, &paramTypeId);
+
+    ctx->Prepare(opIndex);
+    ctx->SetObject(obj);
+
+    switch (ctx->GetEngine()->GetSizeOfPrimitiveType(paramTypeId))
+    {
+    case 1: ctx->SetArgByte(0, (asBYTE) index); break;
+    case 2: ctx->SetArgWord(0, (asWORD) index); break;
+    case 4: ctx->SetArgDWord(0, (asDWORD) index); break;
+    default: ctx->SetArgQWord(0, (asQWORD) index); break;
+    }
+
+    if (ctx->Execute() != asEXECUTION_FINISHED)
+        return {};
+
+    asDWORD flags;
+    int     typeId = opIndex->GetReturnTypeId(&flags);
+    return asIDBValue(ctx->GetEngine(), ctx->GetAddressOfReturnValue(), typeId, (flags & asTM_INOUTREF) != 0, true);
+}
+
+asIDBWorkerPool::~asIDBWorkerPool()
+{
+    {
+        std::scoped_lock lock(mutex);
+        quit = true;
+    }
+
+    wake.notify_all();
+
+    for (auto &thread : threads)
+        thread.join();
+}
+
+/*static*/ asIDBWorkerPool &asIDBWorkerPool::Shared()
+{
+    static asIDBWorkerPool pool;
+    return pool;
+}
+
+size_t asIDBWorkerPool::GetConcurrency() const
+{
+    return std::max(1u, std::thread::hardware_concurrency());
+}
+
+void asIDBWorkerPool::Start()
+{
+    size_t count = GetConcurrency() - 1;
+
+    threads.reserve(count);
+
+    for (size_t i = 0; i < count; i++)
+        threads.emplace_back(&asIDBWorkerPool::Worker, this);
+}
+
+void asIDBWorkerPool::Work()
+{
+    for (size_t i; (i = job_next++) < job_count; )
+        (*job)(i);
+}
+
+void asIDBWorkerPool::Worker()
+{
+    size_t generation = 0;
+
+    while (true)
+    {
+        {
+            std::unique_lock lock(mutex);
+            wake.wait(lock, [&] { return quit || generation != job_generation; });
+
+            if (quit)
+                return;
+
+            generation = job_generation;
+        }
+
+        Work();
+
+        bool last;
+
+        {
+            std::scoped_lock lock(mutex);
+            last = !--pending;
+        }
+
+        if (last)
+            done.notify_one();
+    }
+}
+
+void asIDBWorkerPool::Run(size_t count, const std::function<void(size_t)> &func)
+{
+    if (count <= 1 || GetConcurrency() == 1)
+    {
+        for (size_t i = 0; i < count; i++)
+            func(i);
+        return;
+    }
+
+    std::scoped_lock run_lock(run_mutex);
+
+    if (threads.empty())
+        Start();
+
+    {
+        std::scoped_lock lock(mutex);
+        job = &func;
+        job_count = count;
+        job_next = 0;
+        job_generation++;
+        pending = threads.size();
+    }
+
+    wake.notify_all();
+
+    Work();
+
+    // every worker has to pick up the job before
+    // we return, so none of them can see a stale one.
+    std::unique_lock lock(mutex);
+    done.wait(lock, [&] { return !pending; });
+    job = nullptr;
+}
+
+/*static*/ std::shared_ptr<asIDBSourceFile> asIDBSourceFile::Load(const std::string &path)
+{
+    std::ifstream stream(path, std::ios::binary | std::ios::ate);
+
+    if (!stream)
+        return nullptr;
+
+    std::streamoff size = stream.tellg();
+
+    if (size < 0)
+        return nullptr;
+
+    std::string source(static_cast<size_t>(size), '\0');
+    stream.seekg(0);
+
+    if (!stream.read(source.data(), source.size()))
+        return nullptr;
+
+    return FromString(std::move(source));
+}
+
+/*static*/ std::shared_ptr<asIDBSourceFile> asIDBSourceFile::FromString(std::string source)
+{
+    std::shared_ptr<asIDBSourceFile> file(new asIDBSourceFile());
+    file->text = std::move(source);
+    file->IndexLines();
+    return file;
+}
+
+void asIDBSourceFile::IndexLines()
+{
+    line_starts.clear();
+    line_starts.push_back(0);
+
+    for (const char *p = text.data(), *end = p + text.size();
+         (p = static_cast<const char *>(memchr(p, '\n', end - p))) != nullptr; p++)
+        line_starts.push_back(p - text.data() + 1);
+
+    // a final newline doesn't start another line
+    if (line_starts.size() > 1 && line_starts.back() == text.size())
+        line_starts.pop_back();
+}
+
+std::string_view asIDBSourceFile::GetLines(size_t first, size_t count) const
+{
+    if (!first || first > line_starts.size() || !count)
+        return {};
+
+    size_t start = line_starts[first - 1];
+    size_t last = first - 1 + count;
+    size_t end = last < line_starts.size() ? line_starts[last] : text.size();
+
+    return std::string_view(text).substr(start, end - start);
+}
+
+char *asIDBStringArena::Allocate(size_t size)
+{
+    if (block_used + size > block_capacity)
+    {
+        // large strings get a block of their own
+        size_t capacity = std::max(size, block_size);
+        blocks.push_back(std::make_unique<char[]>(capacity));
+        block_used = 0;
+        block_capacity = capacity;
+        reserved += capacity;
+    }
+
+    char *ptr = blocks.back().get() + block_used;
+    block_used += size;
+    return ptr;
+}
+
+std::string_view asIDBStringArena::Store(std::string_view str)
+{
+    if (str.empty())
+        return {};
+
+    char *ptr = Allocate(str.size());
+    memcpy(ptr, str.data(), str.size());
+    return { ptr, str.size() };
+}
@@ -4,7 +4,16 @@
 #pragma once
 
 #include <angelscript.h>
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <functional>
+#include <limits>
+#include <memory>
+#include <mutex>
+#include <string>
 #include <string_view>
+#include <thread>
 #include <variant>
 #include <vector>
 
@@ -120,12 +129,18 @@ asIDBExpected(E) -> asIDBExpected<void>;
 // helper class that is similar to an any,
 // storing a value of any type returned by AS
 // and managing the ref count.
+// A borrowed value points at an object that something
+// else owns (like a container element returned by
+// reference) instead of holding a copy of it; it's only
+// valid for as long as the owner is, which is the case
+// for the duration of a break.
 struct asIDBValue
 {
 public:
     asIScriptEngine *engine = nullptr;
     int              typeId = 0;
     asITypeInfo     *type = nullptr;
+    bool             borrowed = false;
 
     union {
         asBYTE  u8;
@@ -138,7 +153,9 @@ public:
     } value {};
 
     asIDBValue() = default;
-    asIDBValue(asIScriptEngine *engine, void *ptr, int typeId, bool reference = false);
+    // if `borrow` is set and `reference` is too, value
+    // types are pointed to instead of being copied.
+    asIDBValue(asIScriptEngine *engine, void *ptr, int typeId, bool reference = false, bool borrow = false);
     asIDBValue(const asIDBValue &other);
     asIDBValue(asIDBValue &&other) noexcept;
 
@@ -205,19 +222,192 @@ public:
         return IsValid();
     }
 
-    // individual access
+    // individual access. If a call doesn't finish (it threw
+    // or ran out of time), Begin & Next return an invalid value,
+    // End returns true and Value returns false.
     asIDBValue Begin(asIScriptContext *ctx) const;
-    void       Value(asIScriptContext *ctx, const asIDBValue &val, size_t index) const;
+    bool       Value(asIScriptContext *ctx, const asIDBValue &val, size_t index) const;
     asIDBValue Next(asIScriptContext *ctx, const asIDBValue &val) const;
     bool       End(asIScriptContext *ctx, const asIDBValue &val) const;
 
-    // O(n) helper for length
-    size_t CalculateLength(asIScriptContext *ctx) const;
+    // O(n) helper for length; stops counting at `limit`.
+    // `ctx` must be free to use (not the one being debugged).
+    size_t CalculateLength(asIScriptContext *ctx, size_t limit = std::numeric_limits<size_t>::max()) const;
 
 private:
     bool Validate();
 };
 
+// helper class for random access into containers that
+// have an integral `opIndex` and a `length`/`size` method.
+class asIDBObjectIndexHelper
+{
+public:
+    asITypeInfo       *type;
+    void              *obj;
+    asIScriptFunction *opIndex = nullptr, *length = nullptr;
+
+    asIDBObjectIndexHelper(asITypeInfo *type, void *obj);
+
+    constexpr bool IsValid() const
+    {
+        return opIndex != nullptr && length != nullptr;
+    }
+    constexpr explicit operator bool() const
+    {
+        return IsValid();
+    }
+
+    // O(1) length.
+    size_t Length(asIScriptContext *ctx) const;
+
+    // fetch the element at the given index. Elements returned
+    // by reference are borrowed rather than copied.
+    asIDBValue At(asIScriptContext *ctx, size_t index) const;
+};
+
+// how many bytes of `value` a preview of at most `max_length`
+// bytes keeps. The cut is moved back so that it doesn't land
+// in the middle of a UTF-8 sequence.
+inline size_t asIDBPreviewLength(std::string_view value, size_t max_length)
+{
+    if (value.size() <= max_length)
+        return value.size();
+
+    size_t length = max_length;
+
+    while (length && (static_cast<unsigned char>(value[length]) & 0xC0) == 0x80)
+        length--;
+
+    return length;
+}
+
+// shorten a value to at most `max_length` bytes for display,
+// noting how much was cut off.
+inline std::string asIDBPreview(std::string_view value, size_t max_length)
+{
+    if (value.size() <= max_length)
+        return std::string(value);
+
+    size_t length = asIDBPreviewLength(value, max_length);
+
+    // U+2026 (ellipsis), as UTF-8
+    return fmt::format("{}\xE2\x80\xA6({} more)", value.substr(0, length), value.size() - length);
+}
+
+// bump allocator for strings that all live as long
+// as the arena does; memory is only taken from the
+// system a block at a time.
+class asIDBStringArena
+{
+public:
+    explicit asIDBStringArena(size_t block_size = 64 * 1024) :
+        block_size(block_size)
+    {
+    }
+
+    asIDBStringArena(const asIDBStringArena &) = delete;
+    asIDBStringArena &operator=(const asIDBStringArena &) = delete;
+    asIDBStringArena(asIDBStringArena &&) = default;
+    asIDBStringArena &operator=(asIDBStringArena &&) = default;
+
+    // allocate room for `size` chars.
+    char *Allocate(size_t size);
+
+    // copy the given string into the arena.
+    std::string_view Store(std::string_view str);
+
+    // total bytes taken from the system.
+    size_t GetMemoryUsage() const
+    {
+        return reserved;
+    }
+
+private:
+    std::vector<std::unique_ptr<char[]>> blocks;
+    size_t                               block_size;
+    size_t                               block_used = 0, block_capacity = 0;
+    size_t                               reserved = 0;
+};
+
+// small pool of worker threads for work that is safe to
+// do off of the script thread (reading suspended memory,
+// formatting). Threads are only started on first use.
+class asIDBWorkerPool
+{
+public:
+    asIDBWorkerPool() = default;
+    asIDBWorkerPool(const asIDBWorkerPool &) = delete;
+    asIDBWorkerPool &operator=(const asIDBWorkerPool &) = delete;
+    ~asIDBWorkerPool();
+
+    // the pool shared by every workspace & debugger, so
+    // that the process only ever has one set of workers.
+    static asIDBWorkerPool &Shared();
+
+    // call `func` once for every index in [0, count), spread
+    // across the pool and the calling thread; returns once
+    // every call has finished. Calls from different threads
+    // take turns; `func` must not call Run itself.
+    void Run(size_t count, const std::function<void(size_t)> &func);
+
+    // the number of threads Run will use, including the caller.
+    size_t GetConcurrency() const;
+
+private:
+    void Start();
+    void Worker();
+    void Work();
+
+    std::vector<std::thread>            threads;
+    std::mutex                          run_mutex; // held for the whole of Run
+    std::mutex                          mutex;
+    std::condition_variable             wake, done;
+    const std::function<void(size_t)>  *job = nullptr;
+    size_t                              job_count = 0;
+    std::atomic_size_t                  job_next = 0;
+    size_t                              job_generation = 0;
+    size_t                              pending = 0; // workers that haven't finished this job
+    bool                                quit = false;
+};
+
+// read-only source text held in memory, with the offset of
+// every line start so that any range of lines can be viewed
+// without copying.
+class asIDBSourceFile
+{
+public:
+    asIDBSourceFile(const asIDBSourceFile &) = delete;
+    asIDBSourceFile &operator=(const asIDBSourceFile &) = delete;
+
+    // read the file at the given path; null if it can't be read.
+    static std::shared_ptr<asIDBSourceFile> Load(const std::string &path);
+
+    // wrap source that is already in memory.
+    static std::shared_ptr<asIDBSourceFile> FromString(std::string source);
+
+    std::string_view GetText() const
+    {
+        return text;
+    }
+
+    size_t GetLineCount() const
+    {
+        return line_starts.size();
+    }
+
+    // view `count` lines starting at the 1-based line `first`,
+    // including their line endings; clamped to the file.
+    std::string_view GetLines(size_t first, size_t count = 1) const;
+
+private:
+    asIDBSourceFile() = default;
+    void IndexLines();
+
+    std::string         text;
+    std::vector<size_t> line_starts;
+};
+
 /* -*- mode: c; c-file-style: "k&r" -*-
 
   strnatcmp.c -- Perform 'natural order' comparisons of strings in C.
@@ -406,6 +596,56 @@ struct asIDBNatLess
 
 using asIDBNatILess = asIDBNatLess<false>;
 
+// append a collation key for `s` to `key`, such that comparing
+// keys byte-wise gives the same order as asIDBNatILess. Sorting
+// many strings by key only has to walk each string once, instead
+// of once per comparison.
+inline void asIDBNatIKeyAppend(std::string &key, std::string_view s)
+{
+    using cmp = asIDBNatICmp;
+
+    for (size_t i = 0; i < s.size();)
+    {
+        char c = s[i];
+
+        if (cmp::nat_isspace(c))
+        {
+            i++;
+            continue;
+        }
+        else if (!cmp::nat_isdigit(c))
+        {
+            key.push_back(cmp::nat_toupper(c));
+            i++;
+            continue;
+        }
+
+        size_t end = i;
+
+        while (end < s.size() && cmp::nat_isdigit(s[end]))
+            end++;
+
+        // runs with leading zeroes compare digit by digit, with
+        // the shorter run first; others compare by magnitude, so
+        // the length goes first. the markers are digits themselves
+        // so that runs still sort the same against other characters.
+        if (c == '0')
+        {
+            key.push_back('0');
+            key.append(s.substr(i, end - i));
+            key.push_back('\x01');
+        }
+        else
+        {
+            key.push_back('1');
+            key.push_back((char) (uint8_t) std::min(end - i, (size_t) 0xFF));
+            key.append(s.substr(i, end - i));
+        }
+
+        i = end;
+    }
+}
+
 /*
 MIT License
 
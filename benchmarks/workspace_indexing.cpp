@@ -0,0 +1,89 @@
+// MIT Licensed
+// see https://github.com/Paril/angelscript-debugger
+
+// startup benchmark for asIDBFileWorkspace; builds a large,
+// synthetic set of modules and times how long the workspace
+// takes to index their sections & breakpoint positions.
+//
+//     workspace_indexing [modules] [functions per module] [iterations]
+//
+// build it alongside as_debugger.cpp & as_helpers.cpp, linked
+// against AngelScript, from the repository root:
+//
+//     g++ -std=c++17 -O2 -I<angelscript>/include benchmarks/workspace_indexing.cpp \
+//         as_debugger.cpp as_helpers.cpp -L<angelscript>/lib -langelscript -lfmt -pthread \
+//         -o workspace_indexing
+//
+// (with -std=c++20, std::format is used and -lfmt can be left out.)
+
+#include "../as_debugger.h"
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+
+static std::string GenerateSection(int functions)
+{
+    std::string script;
+
+    for (int f = 0; f < functions; f++)
+    {
+        script += fmt::format("int func{}(int a)\n{{\n    int b = a * {};\n", f, f);
+        script += "    for (int i = 0; i < a; i++)\n        b += i;\n";
+        script += "    if (b > 100)\n        return b;\n    return a + b;\n}\n";
+    }
+
+    script += "class Synthetic\n{\n    int value;\n";
+
+    for (int f = 0; f < functions / 4; f++)
+        script += fmt::format("    int method{}() {{ return value + {}; }}\n", f, f);
+
+    script += "}\n";
+    return script;
+}
+
+int main(int argc, char **argv)
+{
+    int modules = argc > 1 ? atoi(argv[1]) : 200;
+    int functions = argc > 2 ? atoi(argv[2]) : 200;
+    int iterations = argc > 3 ? atoi(argv[3]) : 10;
+
+    asIScriptEngine *engine = asCreateScriptEngine();
+
+    for (int m = 0; m < modules; m++)
+    {
+        std::string      name = fmt::format("module{}", m);
+        std::string      script = GenerateSection(functions);
+        asIScriptModule *module = engine->GetModule(name.c_str(), asGM_ALWAYS_CREATE);
+
+        module->AddScriptSection(fmt::format("{}.as", name).c_str(), script.c_str(), script.size());
+
+        if (module->Build() < 0)
+        {
+            fprintf(stderr, "failed to build %s\n", name.c_str());
+            return 1;
+        }
+    }
+
+    size_t sections = 0, positions = 0;
+    auto   start = std::chrono::steady_clock::now();
+
+    for (int i = 0; i < iterations; i++)
+    {
+        asIDBFileWorkspace workspace("", { engine });
+
+        sections = workspace.potential_breakpoints.size();
+        positions = 0;
+
+        for (auto &[section, linecols] : workspace.potential_breakpoints)
+            positions += linecols.size();
+    }
+
+    auto elapsed = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start);
+
+    printf("%d modules, %d functions each, %zu threads\n", modules, functions, asIDBWorkerPool::Shared().GetConcurrency());
+    printf("%zu sections, %zu breakpoint positions\n", sections, positions);
+    printf("%.3f ms per workspace\n", elapsed.count() / iterations);
+
+    engine->ShutDownAndRelease();
+    return 0;
+}